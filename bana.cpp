@@ -1,7 +1,20 @@
 #include "bana.hpp"
 #include <stdarg.h>
+#include <cmath>
 
-bool heap_realloc(void **ptr, usize new_size) {
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+static void *heap_alloc([[maybe_unused]] void *userdata, usize size) {
+    return std::malloc(size);
+}
+
+static void heap_free([[maybe_unused]] void *userdata, void *ptr) {
+    std::free(ptr);
+}
+
+static bool heap_realloc([[maybe_unused]] void *userdata, void **ptr, usize new_size) {
     void *old_ptr = *ptr;
     void *new_ptr = std::realloc(old_ptr, new_size);
     if (!new_ptr) return false;
@@ -11,30 +24,199 @@ bool heap_realloc(void **ptr, usize new_size) {
 }
 
 Bana::Allocator Bana::heap_allocator = {
-    .alloc   = std::malloc,
-    .free    = std::free,
-    .realloc = heap_realloc
+    .alloc_proc   = heap_alloc,
+    .free_proc    = heap_free,
+    .realloc_proc = heap_realloc,
+    .userdata     = nullptr
 };
 
 static inline bool is_whitespace(char c) {
     return c == ' ' || c == '\n' || c == '\t' || c == '\f' || c == '\r' || c == '\v';
 }
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+static void *virtual_reserve(usize size, [[maybe_unused]] u32 flags) {
+    // Large pages on Windows must be committed up front and need SeLockMemoryPrivilege, so ARENA_HUGE_PAGES is ignored.
+    return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+static bool virtual_commit(void *ptr, usize size) {
+    return VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+}
+
+static void virtual_decommit(void *ptr, usize size) {
+    VirtualFree(ptr, size, MEM_DECOMMIT);
+}
+
+static void virtual_release(void *ptr, [[maybe_unused]] usize size) {
+    VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+static usize virtual_page_size([[maybe_unused]] u32 flags) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwAllocationGranularity;
+}
+
+// Reserve and commit in one go. VirtualAlloc() already aligns to the 64KB allocation granularity.
+static void *virtual_alloc_aligned(usize size, [[maybe_unused]] usize alignment) {
+    assert(alignment <= KILOBYTES(64));
+    return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+#endif
+
+#ifdef __unix__
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define HUGE_PAGE_SIZE MEGABYTES(2)
+
+// Over-map by the alignment and trim the slop on either side.
+static void *mmap_aligned(usize size, usize alignment, i32 prot) {
+    usize padded = size + alignment;
+    u8 *ptr = (u8 *) mmap(nullptr, padded, prot, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ptr == MAP_FAILED) return nullptr;
+
+    u8 *aligned = (u8 *) (((uptr) ptr + alignment - 1) & ~((uptr) alignment - 1));
+    if (aligned != ptr) munmap(ptr, aligned - ptr);
+    usize tail = (ptr + padded) - (aligned + size);
+    if (tail) munmap(aligned + size, tail);
+
+    return aligned;
+}
+
+static void *virtual_reserve(usize size, u32 flags) {
+    if (!FLAG_IS_SET(flags, Bana::ARENA_HUGE_PAGES)) {
+        void *ptr = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+
+    // Transparent huge pages only kick in for 2MB aligned ranges.
+    void *ptr = mmap_aligned(size, HUGE_PAGE_SIZE, PROT_NONE);
+    if (ptr) madvise(ptr, size, MADV_HUGEPAGE);
+    return ptr;
+}
+
+static void *virtual_alloc_aligned(usize size, usize alignment) {
+    return mmap_aligned(size, alignment, PROT_READ | PROT_WRITE);
+}
+
+static bool virtual_commit(void *ptr, usize size) {
+    return mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+static void virtual_decommit(void *ptr, usize size) {
+    madvise(ptr, size, MADV_DONTNEED);
+    mprotect(ptr, size, PROT_NONE);
+}
+
+static void virtual_release(void *ptr, usize size) {
+    munmap(ptr, size);
+}
+
+static usize virtual_page_size(u32 flags) {
+    if (FLAG_IS_SET(flags, Bana::ARENA_HUGE_PAGES)) return HUGE_PAGE_SIZE;
+    return sysconf(_SC_PAGESIZE);
+}
+#endif
+
+// Commit at least this much at a time so that a run of small pushes does not turn into a syscall each.
+#define ARENA_MIN_COMMIT KILOBYTES(64)
+
+static inline usize align_up(usize value, usize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+Bana::Arena Bana::make_virtual_arena(usize reserve_size, usize decommit_watermark, u32 flags) {
+    Arena arena = {};
+
+    usize page_size = virtual_page_size(flags);
+    reserve_size    = align_up(reserve_size, page_size);
+
+    arena.data = (u8 *) virtual_reserve(reserve_size, flags);
+    if (!arena.data) {
+        ICHIGO_ERROR("Failed to reserve %zu bytes for arena!", reserve_size);
+        return {};
+    }
+
+    arena.reserved           = reserve_size;
+    arena.decommit_watermark = align_up(decommit_watermark, page_size);
+    arena.flags              = flags;
+
+    return arena;
+}
+
+void Bana::free_virtual_arena(Arena *arena) {
+    assert(arena->reserved != 0);
+    virtual_release(arena->data, arena->reserved);
+    std::memset(arena, 0, sizeof(Arena));
+}
+
+bool Bana::arena_grow(Arena *arena, usize required_capacity) {
+    if (required_capacity > arena->reserved) return false;
+
+    usize page_size    = virtual_page_size(arena->flags);
+    usize new_capacity = MAX(required_capacity, arena->capacity + ARENA_MIN_COMMIT);
+    new_capacity       = MIN(align_up(new_capacity, page_size), arena->reserved);
+
+    if (!virtual_commit(arena->data + arena->capacity, new_capacity - arena->capacity)) return false;
+
+    arena->capacity = new_capacity;
+    return true;
+}
+
+void Bana::arena_decommit(Arena *arena, usize keep_capacity) {
+    assert(arena->reserved != 0);
+    keep_capacity = MAX(align_up(keep_capacity, virtual_page_size(arena->flags)), align_up(arena->pointer, virtual_page_size(arena->flags)));
+    if (keep_capacity >= arena->capacity) return;
+
+    virtual_decommit(arena->data + keep_capacity, arena->capacity - keep_capacity);
+    arena->capacity = keep_capacity;
+}
+
 void *Bana::push_array(Arena *arena, usize size, usize count) {
     usize len = size * count;
 
-    if (arena->pointer + len > arena->capacity) {
+    if (arena->pointer + len > arena->capacity && !arena_grow(arena, arena->pointer + len)) {
         assert(false && "Out of memory");
         return nullptr;
     }
 
     void *ret = &arena->data[arena->pointer];
     arena->pointer += len;
+    arena->high_water = MAX(arena->high_water, arena->pointer);
+    return ret;
+}
+
+void *Bana::push_array_aligned(Arena *arena, usize size, usize count, usize alignment) {
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of 2");
+
+    // Align the real address, not the offset. Fixed arenas can wrap memory with any alignment.
+    uptr address  = (uptr) &arena->data[arena->pointer];
+    usize padding = align_up(address, alignment) - address;
+    usize len     = padding + size * count;
+
+    if (arena->pointer + len > arena->capacity && !arena_grow(arena, arena->pointer + len)) {
+        assert(false && "Out of memory");
+        return nullptr;
+    }
+
+    void *ret = &arena->data[arena->pointer + padding];
+    arena->pointer += len;
+    arena->high_water = MAX(arena->high_water, arena->pointer);
     return ret;
 }
 
+void *Bana::push_array_simd(Arena *arena, usize size, usize count) {
+    usize len = align_up(size * count, CACHE_LINE_SIZE);
+    return push_array_aligned(arena, len, 1, CACHE_LINE_SIZE);
+}
+
 void *Bana::push_struct(Arena *arena, void *s, usize len) {
-    if (arena->pointer + len > arena->capacity) {
+    if (arena->pointer + len > arena->capacity && !arena_grow(arena, arena->pointer + len)) {
         assert(false && "Out of memory");
         return nullptr;
     }
@@ -42,138 +224,2891 @@ void *Bana::push_struct(Arena *arena, void *s, usize len) {
     void *ret = &arena->data[arena->pointer];
     std::memcpy(ret, s, len);
     arena->pointer += len;
+    arena->high_water = MAX(arena->high_water, arena->pointer);
     return ret;
 }
 
-Bana::String Bana::make_string(const char *cstr, Allocator allocator) {
-    String str;
+// Arena and stack allocator blocks are prefixed with this so that realloc knows how much to copy and free knows where
+// to rewind to. Its size keeps the returned block 16 byte aligned.
+struct ArenaBlockHeader {
+    usize size;
+    uptr  previous_pointer;
+};
 
-    str.length   = std::strlen(cstr);
-    str.capacity = str.length;
-    str.data     = (char *) allocator.alloc(str.capacity);
+static_assert(sizeof(ArenaBlockHeader) == 16);
 
-    std::memcpy(str.data, cstr, str.length);
+static inline ArenaBlockHeader *arena_block_header(void *ptr) {
+    return (ArenaBlockHeader *) ptr - 1;
+}
 
-    return str;
+static inline bool arena_block_is_last(Bana::Arena *arena, void *ptr) {
+    return (u8 *) ptr + arena_block_header(ptr)->size == &arena->data[arena->pointer];
 }
 
-Bana::String Bana::make_string(const char *bytes, usize length, Allocator allocator) {
-    String str;
+static void *arena_alloc(void *userdata, usize size) {
+    Bana::Arena *arena = (Bana::Arena *) userdata;
+    uptr previous      = arena->pointer;
 
-    str.length   = length;
-    str.capacity = str.length;
-    str.data     = (char *) allocator.alloc(str.capacity);
+    ArenaBlockHeader *header = (ArenaBlockHeader *) Bana::push_array_aligned(arena, sizeof(ArenaBlockHeader) + size, 1, alignof(ArenaBlockHeader) * 2);
+    if (!header) return nullptr;
 
-    std::memcpy(str.data, bytes, str.length);
+    header->size             = size;
+    header->previous_pointer = previous;
+    return header + 1;
+}
 
-    return str;
+static void arena_free(void *userdata, void *ptr) {
+    if (!ptr) return;
+
+    Bana::Arena *arena = (Bana::Arena *) userdata;
+    if (arena_block_is_last(arena, ptr)) arena->pointer = arena_block_header(ptr)->previous_pointer;
 }
 
-Bana::String Bana::make_string(usize capacity, Allocator allocator) {
-    String str;
+static bool arena_realloc(void *userdata, void **ptr, usize new_size) {
+    Bana::Arena *arena = (Bana::Arena *) userdata;
 
-    str.length   = 0;
-    str.capacity = capacity;
-    str.data     = (char *) allocator.alloc(str.capacity);
+    if (!*ptr) {
+        *ptr = arena_alloc(userdata, new_size);
+        return *ptr != nullptr;
+    }
 
-    return str;
+    ArenaBlockHeader *header = arena_block_header(*ptr);
+
+    if (arena_block_is_last(arena, *ptr)) {
+        usize block_start = (u8 *) *ptr - arena->data;
+        if (block_start + new_size > arena->capacity && !Bana::arena_grow(arena, block_start + new_size)) return false;
+
+        arena->pointer    = block_start + new_size;
+        arena->high_water = MAX(arena->high_water, arena->pointer);
+        header->size      = new_size;
+        return true;
+    }
+
+    if (new_size <= header->size) {
+        header->size = new_size;
+        return true;
+    }
+
+    void *new_ptr = arena_alloc(userdata, new_size);
+    if (!new_ptr) return false;
+
+    std::memcpy(new_ptr, *ptr, header->size);
+    *ptr = new_ptr;
+    return true;
 }
 
-Bana::String Bana::make_string(const Bana::String &other, Allocator allocator) {
-    return make_string(other.data, other.length, allocator);
+static void stack_free(void *userdata, void *ptr) {
+    if (!ptr) return;
+
+    Bana::Arena *arena = (Bana::Arena *) userdata;
+    assert(arena_block_is_last(arena, ptr) && "Stack allocator blocks must be freed in LIFO order");
+    arena->pointer = arena_block_header(ptr)->previous_pointer;
 }
 
-Bana::String Bana::make_formatted_string(Allocator allocator, const char *fmt, va_list args) {
-    isize string_length = std::vsnprintf(nullptr, 0, fmt, args) + 1;
-    String ret          = make_string(string_length, allocator);
+static void *pool_alloc(void *userdata, usize size) {
+    Bana::FreeList *pool = (Bana::FreeList *) userdata;
+    if (size > pool->item_size) return nullptr;
+    return pool->alloc(pool->item_size);
+}
 
-    std::vsnprintf(ret.data, ret.capacity, fmt, args);
-    ret.length = string_length - 1;
+static void pool_free(void *userdata, void *ptr) {
+    if (!ptr) return;
+    ((Bana::FreeList *) userdata)->free((u8 *) ptr);
+}
 
-    return ret;
+static bool pool_realloc(void *userdata, void **ptr, usize new_size) {
+    Bana::FreeList *pool = (Bana::FreeList *) userdata;
+    if (new_size > pool->item_size) return false;
+    if (!*ptr) *ptr = pool_alloc(userdata, new_size);
+    return *ptr != nullptr;
 }
 
-Bana::String Bana::temp_string(const char *bytes, usize length) {
-    String str;
+Bana::Allocator Bana::make_arena_allocator(Arena *arena) {
+    return { arena_alloc, arena_free, arena_realloc, arena };
+}
 
-    str.length   = length;
-    str.capacity = str.length;
-    str.data     = (char *) bytes;
+Bana::Allocator Bana::make_stack_allocator(Arena *arena) {
+    return { arena_alloc, stack_free, arena_realloc, arena };
+}
 
-    return str;
+Bana::Allocator Bana::make_pool_allocator(FreeList *pool) {
+    return { pool_alloc, pool_free, pool_realloc, pool };
 }
 
-Bana::String Bana::temp_string(const char *cstr) {
-    String str;
+void Bana::print_arena_usage(const char *name, const Arena *arena) {
+    std::printf("%s: %zu bytes in use, high-water %zu, committed %zu, reserved %zu\n", name, (usize) arena->pointer, arena->high_water, arena->capacity, arena->reserved);
+}
 
-    str.length   = std::strlen(cstr);
-    str.capacity = str.length;
-    str.data     = (char *) cstr;
+// Tracked blocks are prefixed with this. Its size keeps the returned block 16 byte aligned like the other headers.
+struct Bana::TrackedBlockHeader {
+    AllocationSite *site;
+    usize size;
+    TrackedBlockHeader *previous;
+    TrackedBlockHeader *next;
+};
 
-    return str;
+static_assert(sizeof(Bana::TrackedBlockHeader) == 32);
+
+static inline u32 tracking_histogram_bucket(usize size) {
+    if (size <= 16) return 0;
+    u32 bucket = 64 - __builtin_clzll(size - 1) - 4;
+    return MIN(bucket, TRACKING_HISTOGRAM_BUCKETS - 1);
 }
 
-void Bana::free_string(String *str, Allocator allocator) {
-    allocator.free(str->data);
-    std::memset(str, 0, sizeof(String));
+static void tracking_link(Bana::TrackingAllocator *tracker, Bana::TrackedBlockHeader *header) {
+    header->previous = nullptr;
+    header->next     = tracker->live_blocks;
+    if (tracker->live_blocks) tracker->live_blocks->previous = header;
+    tracker->live_blocks = header;
 }
 
-void Bana::string_concat(String &dst, const String &src) {
-    assert(dst.capacity >= dst.length + src.length);
-    std::memcpy(&dst.data[dst.length], src.data, src.length);
-    dst.length += src.length;
+static void tracking_unlink(Bana::TrackingAllocator *tracker, Bana::TrackedBlockHeader *header) {
+    if (header->previous) header->previous->next = header->next;
+    else                  tracker->live_blocks   = header->next;
+    if (header->next) header->next->previous = header->previous;
 }
 
-void Bana::string_concat(String &dst, char c) {
-    assert(dst.capacity >= dst.length + 1);
-    dst.data[dst.length] = c;
-    ++dst.length;
+// Charge a change in live size to a site and the tracker. Called with the lock held.
+static void tracking_account(Bana::AllocationSite *site, usize old_size, usize new_size) {
+    Bana::TrackingAllocator *tracker = site->tracker;
+
+    site->live_bytes    = site->live_bytes - old_size + new_size;
+    tracker->live_bytes = tracker->live_bytes - old_size + new_size;
+    site->peak_bytes    = MAX(site->peak_bytes, site->live_bytes);
+    tracker->peak_bytes = MAX(tracker->peak_bytes, tracker->live_bytes);
+    if (new_size > old_size) site->total_bytes += new_size - old_size;
 }
 
-void Bana::string_concat(String &dst, const char *cstr) {
-    usize src_length = std::strlen(cstr);
-    assert(dst.capacity >= dst.length + src_length);
-    std::memcpy(&dst.data[dst.length], cstr, src_length);
-    dst.length += src_length;
+static void *tracking_alloc(void *userdata, usize size) {
+    Bana::AllocationSite *site       = (Bana::AllocationSite *) userdata;
+    Bana::TrackingAllocator *tracker = site->tracker;
+
+    Bana::TrackedBlockHeader *header = (Bana::TrackedBlockHeader *) tracker->backing.alloc(sizeof(Bana::TrackedBlockHeader) + size);
+    if (!header) return nullptr;
+
+    header->site = site;
+    header->size = size;
+
+    tracker->lock.lock();
+    tracking_link(tracker, header);
+    tracking_account(site, 0, size);
+    site->alloc_count++;
+    site->live_count++;
+    site->histogram[tracking_histogram_bucket(size)]++;
+    tracker->live_count++;
+    tracker->lock.unlock();
+
+    return header + 1;
 }
 
-static void string_format_va(Bana::String &dst, const char *fmt, va_list args) {
-    dst.length = 0;
+static void tracking_free(void *userdata, void *ptr) {
+    if (!ptr) return;
 
-    isize ret = std::vsnprintf(dst.data, dst.capacity, fmt, args);
+    Bana::TrackingAllocator *tracker = ((Bana::AllocationSite *) userdata)->tracker;
+    Bana::TrackedBlockHeader *header = (Bana::TrackedBlockHeader *) ptr - 1;
+    Bana::AllocationSite *site       = header->site;
+    assert(site->tracker == tracker && "Block was not allocated by this tracker");
 
-    if (ret < 0 || ret > (isize) dst.capacity) return;
+    tracker->lock.lock();
+    tracking_unlink(tracker, header);
+    tracking_account(site, header->size, 0);
+    site->live_count--;
+    tracker->live_count--;
+    tracker->lock.unlock();
 
-    dst.length = ret;
+    tracker->backing.free(header);
 }
 
-// FIXME: standard vsnprintf null terminates the string.
-void Bana::string_format(String &dst, const char *fmt, ...) {
-    va_list args;
-    va_start(args, fmt);
-    string_format_va(dst, fmt, args);
-    va_end(args);
+static bool tracking_realloc(void *userdata, void **ptr, usize new_size) {
+    if (!*ptr) {
+        *ptr = tracking_alloc(userdata, new_size);
+        return *ptr != nullptr;
+    }
+
+    Bana::TrackingAllocator *tracker = ((Bana::AllocationSite *) userdata)->tracker;
+    Bana::TrackedBlockHeader *header = (Bana::TrackedBlockHeader *) *ptr - 1;
+    Bana::AllocationSite *site       = header->site;
+    usize old_size                   = header->size;
+    assert(site->tracker == tracker && "Block was not allocated by this tracker");
+
+    // The block can move, so take it off the live list while the backing allocator has it.
+    tracker->lock.lock();
+    tracking_unlink(tracker, header);
+    tracker->lock.unlock();
+
+    void *block  = header;
+    bool success = tracker->backing.realloc(&block, sizeof(Bana::TrackedBlockHeader) + new_size);
+    if (success) header = (Bana::TrackedBlockHeader *) block;
+
+    // Growth stays charged to the site that made the block, whichever site's allocator resized it.
+    tracker->lock.lock();
+    tracking_link(tracker, header);
+    if (success) {
+        header->size = new_size;
+        tracking_account(site, old_size, new_size);
+        site->realloc_count++;
+        site->histogram[tracking_histogram_bucket(new_size)]++;
+    }
+    tracker->lock.unlock();
+
+    *ptr = header + 1;
+    return success;
 }
 
-void Bana::string_strip_whitespace(String &str) {
-    for (usize i = 0; i < str.length; ++i) {
-        if (is_whitespace(str.data[i])) {
-            std::memmove(&str.data[i], &str.data[i + 1], str.length - i - 1);
-            --str.length;
-            --i;
+Bana::Arena *Bana::allocator_arena(Allocator allocator) {
+    if (allocator.alloc_proc == arena_alloc)    return (Arena *) allocator.userdata;
+    if (allocator.alloc_proc == tracking_alloc) return allocator_arena(((AllocationSite *) allocator.userdata)->tracker->backing);
+    return nullptr;
+}
+
+Bana::TrackingAllocator Bana::make_tracking_allocator(Allocator backing) {
+    TrackingAllocator ret = {};
+    ret.backing           = backing;
+    ret.sites             = make_array<AllocationSite *>(64, backing);
+    return ret;
+}
+
+void Bana::free_tracking_allocator(TrackingAllocator *tracker) {
+    if (tracker->live_count) ICHIGO_ERROR("Freeing a tracking allocator with %llu blocks (%zu bytes) still live", (unsigned long long) tracker->live_count, tracker->live_bytes);
+
+    for (isize i = 0; i < tracker->sites.size; ++i) tracker->backing.free(tracker->sites[i]);
+    tracker->backing.free(tracker->sites.data);
+    *tracker = {};
+}
+
+static Bana::Allocator tracking_site_allocator(Bana::TrackingAllocator *tracker, const char *tag, const char *file, i32 line) {
+    Bana::AllocationSite *site = nullptr;
+
+    // Sites are only looked up when an allocator is handed out, not on every allocation. The same header can be
+    // compiled into several translation units with different __FILE__ pointers, so fall back to comparing the text.
+    tracker->lock.lock();
+    for (isize i = 0; i < tracker->sites.size; ++i) {
+        Bana::AllocationSite *candidate = tracker->sites[i];
+        if (candidate->line != line) continue;
+        if (tag  && (!candidate->tag  || (candidate->tag != tag && std::strcmp(candidate->tag, tag) != 0))) continue;
+        if (file && (!candidate->file || (candidate->file != file && std::strcmp(candidate->file, file) != 0))) continue;
+
+        site = candidate;
+        break;
+    }
+
+    if (!site) {
+        site = (Bana::AllocationSite *) tracker->backing.alloc(sizeof(Bana::AllocationSite));
+        assert(site);
+
+        std::memset(site, 0, sizeof(Bana::AllocationSite));
+        site->tracker = tracker;
+        site->id      = (u32) tracker->sites.size;
+        site->tag     = tag;
+        site->file    = file;
+        site->line    = line;
+        tracker->sites.append(site);
+    }
+    tracker->lock.unlock();
+
+    return { tracking_alloc, tracking_free, tracking_realloc, site };
+}
+
+Bana::Allocator Bana::tracked_allocator(TrackingAllocator *tracker, const char *file, i32 line) {
+    return tracking_site_allocator(tracker, nullptr, file, line);
+}
+
+Bana::Allocator Bana::tagged_allocator(TrackingAllocator *tracker, const char *tag) {
+    return tracking_site_allocator(tracker, tag, nullptr, 0);
+}
+
+Bana::AllocationSnapshot Bana::take_allocation_snapshot(TrackingAllocator *tracker, Allocator allocator) {
+    AllocationSnapshot ret = {};
+
+    // allocator may be the tracker itself, so the copy is allocated outside the lock and sized again once it is held.
+    for (;;) {
+        tracker->lock.lock();
+        isize site_count = tracker->sites.size;
+        tracker->lock.unlock();
+
+        ret.sites = make_fixed_array<AllocationSite>(MAX(site_count, 1), allocator);
+
+        tracker->lock.lock();
+        if (tracker->sites.size <= ret.sites.capacity) break;
+        tracker->lock.unlock();
+        free_fixed_array(&ret.sites, allocator);
+    }
+
+    for (isize i = 0; i < tracker->sites.size; ++i) ret.sites.data[i] = *tracker->sites[i];
+    ret.sites.size  = tracker->sites.size;
+    ret.live_bytes  = tracker->live_bytes;
+    ret.peak_bytes  = tracker->peak_bytes;
+    ret.live_count  = tracker->live_count;
+    tracker->lock.unlock();
+
+    return ret;
+}
+
+void Bana::free_allocation_snapshot(AllocationSnapshot *snapshot, Allocator allocator) {
+    free_fixed_array(&snapshot->sites, allocator);
+    *snapshot = {};
+}
+
+static void print_allocation_site_name(const Bana::AllocationSite &site) {
+    if (site.tag) std::printf("%-40s", site.tag);
+    else          std::printf("%32s:%-7d", site.file, site.line);
+}
+
+static int compare_sites_by_live_bytes(const void *a, const void *b) {
+    usize lhs = ((const Bana::AllocationSite *) a)->live_bytes;
+    usize rhs = ((const Bana::AllocationSite *) b)->live_bytes;
+    return lhs < rhs ? 1 : lhs > rhs ? -1 : 0;
+}
+
+void Bana::print_allocation_report(TrackingAllocator *tracker) {
+    AllocationSnapshot snapshot = take_allocation_snapshot(tracker, tracker->backing);
+    std::qsort(snapshot.sites.data, snapshot.sites.size, sizeof(AllocationSite), compare_sites_by_live_bytes);
+
+    std::printf("%zu bytes live in %llu blocks, peak %zu bytes\n", snapshot.live_bytes, (unsigned long long) snapshot.live_count, snapshot.peak_bytes);
+    std::printf("%-40s %12s %8s %12s %10s %10s %12s  histogram (bucket <= size: count)\n", "site", "live bytes", "live", "peak bytes", "allocs", "reallocs", "avg request");
+    for (isize i = 0; i < snapshot.sites.size; ++i) {
+        const AllocationSite &site = snapshot.sites[i];
+        if (site.alloc_count == 0) continue;
+
+        u64 requests = site.alloc_count + site.realloc_count;
+        print_allocation_site_name(site);
+        std::printf(" %12zu %8llu %12zu %10llu %10llu %12zu ", site.live_bytes, (unsigned long long) site.live_count, site.peak_bytes, (unsigned long long) site.alloc_count,
+                    (unsigned long long) site.realloc_count, (usize) (site.total_bytes / requests));
+
+        for (u32 bucket = 0; bucket < TRACKING_HISTOGRAM_BUCKETS; ++bucket) {
+            if (site.histogram[bucket]) std::printf(" %llu:%llu", 16ull << bucket, (unsigned long long) site.histogram[bucket]);
         }
+        std::printf("\n");
     }
+
+    free_allocation_snapshot(&snapshot, tracker->backing);
 }
 
-u32 Bana::parse_hex_u32(String str) {
-    u32 res = 0;
-    for (usize i = 0; i < str.length; ++i) {
-        res *= 16;
-        if      (str.data[i] >= 'A' && str.data[i] <= 'F') res += str.data[i] - 'A' + 10;
-        else if (str.data[i] >= 'a' && str.data[i] <= 'f') res += str.data[i] - 'a' + 10;
-        else if (str.data[i] >= '0' && str.data[i] <= '9') res += str.data[i] - '0';
-        else return 0;
+void Bana::print_allocation_diff(const AllocationSnapshot &before, const AllocationSnapshot &after) {
+    std::printf("live bytes %+lld (%zu -> %zu), live blocks %+lld\n", (long long) after.live_bytes - (long long) before.live_bytes, before.live_bytes, after.live_bytes,
+                (long long) after.live_count - (long long) before.live_count);
+    std::printf("%-40s %14s %12s %10s %10s\n", "site", "live bytes", "live", "allocs", "reallocs");
+
+    // Sites are only ever added, so a site's id is its index in both snapshots.
+    for (isize i = 0; i < after.sites.size; ++i) {
+        AllocationSite empty       = {};
+        const AllocationSite &site = after.sites[i];
+        const AllocationSite &old  = i < before.sites.size ? before.sites[i] : empty;
+        if (site.alloc_count == old.alloc_count && site.realloc_count == old.realloc_count && site.live_bytes == old.live_bytes) continue;
+
+        print_allocation_site_name(site);
+        std::printf(" %+14lld %+12lld %10llu %10llu%s\n", (long long) site.live_bytes - (long long) old.live_bytes, (long long) site.live_count - (long long) old.live_count,
+                    (unsigned long long) (site.alloc_count - old.alloc_count), (unsigned long long) (site.realloc_count - old.realloc_count),
+                    site.live_bytes > old.live_bytes ? "  <- grew" : "");
+    }
+}
+
+void Bana::print_live_allocations(TrackingAllocator *tracker, isize max_blocks) {
+    tracker->lock.lock();
+    std::printf("%llu live blocks, %zu bytes\n", (unsigned long long) tracker->live_count, tracker->live_bytes);
+
+    isize printed = 0;
+    for (TrackedBlockHeader *header = tracker->live_blocks; header && printed < max_blocks; header = header->next, ++printed) {
+        std::printf("  %p %10zu bytes  ", (void *) (header + 1), header->size);
+        print_allocation_site_name(*header->site);
+        std::printf("\n");
     }
 
-    return res;
+    if ((u64) printed < tracker->live_count) std::printf("  ... %llu more\n", (unsigned long long) (tracker->live_count - printed));
+    tracker->lock.unlock();
+}
+
+thread_local static Bana::Arena scratch_arenas[SCRATCH_ARENA_COUNT];
+
+Bana::Arena *Bana::get_scratch_arena(Arena *const *conflicts, usize conflict_count) {
+    for (u32 i = 0; i < SCRATCH_ARENA_COUNT; ++i) {
+        Arena *arena = &scratch_arenas[i];
+
+        bool conflicting = false;
+        for (usize j = 0; j < conflict_count; ++j) {
+            if (conflicts[j] == arena) {
+                conflicting = true;
+                break;
+            }
+        }
+
+        if (conflicting) continue;
+
+        if (!arena->data) *arena = make_virtual_arena(SCRATCH_ARENA_RESERVE, MEGABYTES(4));
+        return arena;
+    }
+
+    assert(false && "Every scratch arena conflicts");
+    return nullptr;
+}
+
+void Bana::free_scratch_arenas() {
+    for (u32 i = 0; i < SCRATCH_ARENA_COUNT; ++i) {
+        if (scratch_arenas[i].data) free_virtual_arena(&scratch_arenas[i]);
+    }
+}
+
+// Every span and large mapping is SLAB_SPAN_SIZE aligned and starts with this header, so a block's span is found by
+// masking its address.
+struct alignas(64) SlabSpan {
+    u32 size_class;
+    usize mapping_size;
+};
+
+#define SLAB_LARGE_CLASS   0xFFFFFFFF
+#define SLAB_CHUNK_SIZE    MEGABYTES(1)
+#define SLAB_SPAN_OF(PTR)  ((SlabSpan *) ((uptr) (PTR) & ~((uptr) SLAB_SPAN_SIZE - 1)))
+
+struct SlabBlock {
+    SlabBlock *next;
+};
+
+struct SlabCentralClass {
+    Bana::SpinLock lock;
+    SlabBlock *free_head;
+    usize free_count;
+    usize spans;
+};
+
+struct SlabThreadCache {
+    SlabBlock *heads[SLAB_CLASS_COUNT];
+    usize counts[SLAB_CLASS_COUNT];
+    SlabThreadCache *next;
+    SlabThreadCache *prev;
+    bool registered;
+    // Set once the destructor has run. Thread local destructors that run after it still allocate and free, but nothing
+    // would flush the cache again, so those go straight to the central lists.
+    bool dead;
+
+    ~SlabThreadCache();
+};
+
+static SlabCentralClass slab_classes[SLAB_CLASS_COUNT];
+
+// Spans are carved out of SLAB_CHUNK_SIZE mappings to keep the syscall count down.
+static Bana::SpinLock slab_chunk_lock;
+static u8 *slab_chunk_cursor;
+static u8 *slab_chunk_end;
+static usize slab_mapped_bytes;
+static usize slab_large_bytes;
+static usize slab_large_count;
+
+static Bana::SpinLock slab_caches_lock;
+static SlabThreadCache *slab_caches;
+thread_local static SlabThreadCache slab_thread_cache;
+
+// 16 byte steps up to 128, then 4 classes per power of 2 up to 8KB.
+static inline u32 slab_size_class(usize size) {
+    if (size <= 128) return size == 0 ? 0 : (size + 15) / 16 - 1;
+
+    usize s = size - 1;
+    u32 k   = 63 - __builtin_clzll(s);
+    return 8 + (k - 7) * 4 + ((s >> (k - 2)) & 3);
+}
+
+static inline usize slab_class_size(u32 size_class) {
+    if (size_class < 8) return (size_class + 1) * 16;
+
+    u32 k = 7 + (size_class - 8) / 4;
+    u32 q = (size_class - 8) % 4;
+    return ((usize) 1 << k) + (q + 1) * ((usize) 1 << (k - 2));
+}
+
+static inline usize slab_blocks_per_span(u32 size_class) {
+    return (SLAB_SPAN_SIZE - sizeof(SlabSpan)) / slab_class_size(size_class);
+}
+
+// How many blocks move between a thread cache and the central list at once. A thread cache holds at most twice this.
+static inline usize slab_batch_size(u32 size_class) {
+    return MAX((usize) 8, MIN((usize) 128, KILOBYTES(16) / slab_class_size(size_class)));
+}
+
+static SlabSpan *slab_new_span(u32 size_class) {
+    slab_chunk_lock.lock();
+
+    if (slab_chunk_cursor == slab_chunk_end) {
+        slab_chunk_cursor = (u8 *) virtual_alloc_aligned(SLAB_CHUNK_SIZE, SLAB_SPAN_SIZE);
+        if (!slab_chunk_cursor) {
+            slab_chunk_end = nullptr;
+            slab_chunk_lock.unlock();
+            return nullptr;
+        }
+
+        slab_chunk_end     = slab_chunk_cursor + SLAB_CHUNK_SIZE;
+        slab_mapped_bytes += SLAB_CHUNK_SIZE;
+    }
+
+    SlabSpan *span = (SlabSpan *) slab_chunk_cursor;
+    slab_chunk_cursor += SLAB_SPAN_SIZE;
+    slab_chunk_lock.unlock();
+
+    span->size_class   = size_class;
+    span->mapping_size = SLAB_SPAN_SIZE;
+    return span;
+}
+
+static void slab_register_thread_cache(SlabThreadCache *cache) {
+    slab_caches_lock.lock();
+    cache->next = slab_caches;
+    cache->prev = nullptr;
+    if (slab_caches) slab_caches->prev = cache;
+    slab_caches       = cache;
+    cache->registered = true;
+    slab_caches_lock.unlock();
+}
+
+// Move up to a batch of blocks from the central list, carving a new span if it is empty.
+static bool slab_refill(SlabThreadCache *cache, u32 size_class) {
+    if (!cache->registered && !cache->dead) slab_register_thread_cache(cache);
+
+    SlabCentralClass *central = &slab_classes[size_class];
+    usize batch               = slab_batch_size(size_class);
+
+    central->lock.lock();
+
+    if (central->free_count == 0) {
+        central->lock.unlock();
+
+        SlabSpan *span = slab_new_span(size_class);
+        if (!span) return false;
+
+        // Keep the first batch for ourselves and hand the rest of the span to the central list.
+        usize block_size = slab_class_size(size_class);
+        usize count      = slab_blocks_per_span(size_class);
+        u8 *blocks       = (u8 *) (span + 1);
+        usize keep       = MIN(batch, count);
+
+        SlabBlock *rest_head = nullptr;
+        for (usize i = count; i > keep; --i) {
+            SlabBlock *block = (SlabBlock *) (blocks + (i - 1) * block_size);
+            block->next      = rest_head;
+            rest_head        = block;
+        }
+
+        for (usize i = keep; i > 0; --i) {
+            SlabBlock *block = (SlabBlock *) (blocks + (i - 1) * block_size);
+            block->next      = cache->heads[size_class];
+            cache->heads[size_class] = block;
+        }
+
+        __atomic_store_n(&cache->counts[size_class], cache->counts[size_class] + keep, __ATOMIC_RELAXED);
+
+        central->lock.lock();
+        central->spans++;
+        if (rest_head) {
+            SlabBlock *tail = (SlabBlock *) (blocks + (count - 1) * block_size);
+            tail->next           = central->free_head;
+            central->free_head   = rest_head;
+            central->free_count += count - keep;
+        }
+        central->lock.unlock();
+
+        return true;
+    }
+
+    usize moved = 0;
+    while (moved < batch && central->free_head) {
+        SlabBlock *block   = central->free_head;
+        central->free_head = block->next;
+        block->next        = cache->heads[size_class];
+        cache->heads[size_class] = block;
+        ++moved;
+    }
+
+    central->free_count -= moved;
+    central->lock.unlock();
+
+    __atomic_store_n(&cache->counts[size_class], cache->counts[size_class] + moved, __ATOMIC_RELAXED);
+    return true;
+}
+
+static void slab_flush(SlabThreadCache *cache, u32 size_class, usize count) {
+    if (count == 0) return;
+
+    SlabBlock *head = cache->heads[size_class];
+    SlabBlock *tail = head;
+    for (usize i = 1; i < count; ++i) tail = tail->next;
+
+    cache->heads[size_class] = tail->next;
+    __atomic_store_n(&cache->counts[size_class], cache->counts[size_class] - count, __ATOMIC_RELAXED);
+
+    SlabCentralClass *central = &slab_classes[size_class];
+    central->lock.lock();
+    tail->next           = central->free_head;
+    central->free_head   = head;
+    central->free_count += count;
+    central->lock.unlock();
+}
+
+SlabThreadCache::~SlabThreadCache() {
+    Bana::slab_allocator_flush_thread_cache();
+
+    dead = true;
+    if (!registered) return;
+
+    slab_caches_lock.lock();
+    if (prev) prev->next = next;
+    else      slab_caches = next;
+    if (next) next->prev = prev;
+    slab_caches_lock.unlock();
+
+    registered = false;
+}
+
+void Bana::slab_allocator_flush_thread_cache() {
+    for (u32 i = 0; i < SLAB_CLASS_COUNT; ++i) slab_flush(&slab_thread_cache, i, slab_thread_cache.counts[i]);
+}
+
+static void *slab_alloc_large(usize size) {
+    usize mapping_size = align_up(sizeof(SlabSpan) + size, KILOBYTES(4));
+    SlabSpan *span     = (SlabSpan *) virtual_alloc_aligned(mapping_size, SLAB_SPAN_SIZE);
+    if (!span) return nullptr;
+
+    span->size_class   = SLAB_LARGE_CLASS;
+    span->mapping_size = mapping_size;
+
+    __atomic_fetch_add(&slab_large_bytes, mapping_size, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&slab_large_count, 1, __ATOMIC_RELAXED);
+    return span + 1;
+}
+
+static void *slab_alloc([[maybe_unused]] void *userdata, usize size) {
+    if (size > SLAB_MAX_SMALL_SIZE) return slab_alloc_large(size);
+
+    u32 size_class         = slab_size_class(size);
+    SlabThreadCache *cache = &slab_thread_cache;
+
+    if (!cache->heads[size_class] && !slab_refill(cache, size_class)) return nullptr;
+
+    SlabBlock *block         = cache->heads[size_class];
+    cache->heads[size_class] = block->next;
+    __atomic_store_n(&cache->counts[size_class], cache->counts[size_class] - 1, __ATOMIC_RELAXED);
+
+    if (cache->dead) slab_flush(cache, size_class, cache->counts[size_class]);
+    return block;
+}
+
+static void slab_free([[maybe_unused]] void *userdata, void *ptr) {
+    if (!ptr) return;
+
+    SlabSpan *span = SLAB_SPAN_OF(ptr);
+
+    if (span->size_class == SLAB_LARGE_CLASS) {
+        __atomic_fetch_sub(&slab_large_bytes, span->mapping_size, __ATOMIC_RELAXED);
+        __atomic_fetch_sub(&slab_large_count, 1, __ATOMIC_RELAXED);
+        virtual_release(span, span->mapping_size);
+        return;
+    }
+
+    u32 size_class         = span->size_class;
+    SlabThreadCache *cache = &slab_thread_cache;
+    SlabBlock *block       = (SlabBlock *) ptr;
+
+    block->next              = cache->heads[size_class];
+    cache->heads[size_class] = block;
+    __atomic_store_n(&cache->counts[size_class], cache->counts[size_class] + 1, __ATOMIC_RELAXED);
+
+    if (cache->dead) slab_flush(cache, size_class, cache->counts[size_class]);
+    else if (cache->counts[size_class] > slab_batch_size(size_class) * 2) slab_flush(cache, size_class, slab_batch_size(size_class));
+}
+
+static bool slab_realloc(void *userdata, void **ptr, usize new_size) {
+    if (!*ptr) {
+        *ptr = slab_alloc(userdata, new_size);
+        return *ptr != nullptr;
+    }
+
+    SlabSpan *span = SLAB_SPAN_OF(*ptr);
+    usize old_size = span->size_class == SLAB_LARGE_CLASS ? span->mapping_size - sizeof(SlabSpan) : slab_class_size(span->size_class);
+
+    // Still fits and would not move to a smaller class.
+    if (new_size <= old_size && (span->size_class == SLAB_LARGE_CLASS || new_size > SLAB_MAX_SMALL_SIZE || slab_size_class(new_size) == span->size_class)) return true;
+
+    void *new_ptr = slab_alloc(userdata, new_size);
+    if (!new_ptr) return false;
+
+    std::memcpy(new_ptr, *ptr, MIN(old_size, new_size));
+    slab_free(userdata, *ptr);
+    *ptr = new_ptr;
+    return true;
+}
+
+Bana::Allocator Bana::slab_allocator = {
+    .alloc_proc   = slab_alloc,
+    .free_proc    = slab_free,
+    .realloc_proc = slab_realloc,
+    .userdata     = nullptr
+};
+
+Bana::SlabAllocatorStats Bana::slab_allocator_stats() {
+    SlabAllocatorStats stats = {};
+
+    for (u32 i = 0; i < SLAB_CLASS_COUNT; ++i) {
+        SlabClassStats &c = stats.classes[i];
+        c.block_size      = slab_class_size(i);
+
+        slab_classes[i].lock.lock();
+        c.spans               = slab_classes[i].spans;
+        c.central_free_blocks = slab_classes[i].free_count;
+        slab_classes[i].lock.unlock();
+    }
+
+    slab_caches_lock.lock();
+    for (SlabThreadCache *cache = slab_caches; cache; cache = cache->next) {
+        for (u32 i = 0; i < SLAB_CLASS_COUNT; ++i) stats.classes[i].cached_blocks += __atomic_load_n(&cache->counts[i], __ATOMIC_RELAXED);
+    }
+    slab_caches_lock.unlock();
+
+    for (u32 i = 0; i < SLAB_CLASS_COUNT; ++i) {
+        SlabClassStats &c = stats.classes[i];
+        usize carved      = c.spans * slab_blocks_per_span(i);
+        usize free_blocks = c.cached_blocks + c.central_free_blocks;
+
+        c.in_use_blocks     = carved > free_blocks ? carved - free_blocks : 0;
+        stats.in_use_bytes += c.in_use_blocks * c.block_size;
+        stats.free_bytes   += free_blocks * c.block_size;
+    }
+
+    slab_chunk_lock.lock();
+    stats.mapped_bytes = slab_mapped_bytes;
+    slab_chunk_lock.unlock();
+
+    stats.large_bytes   = __atomic_load_n(&slab_large_bytes, __ATOMIC_RELAXED);
+    stats.large_count   = __atomic_load_n(&slab_large_count, __ATOMIC_RELAXED);
+    stats.mapped_bytes += stats.large_bytes;
+    stats.in_use_bytes += stats.large_bytes;
+    stats.fragmentation = stats.mapped_bytes ? 1.0 - (f64) stats.in_use_bytes / (f64) stats.mapped_bytes : 0.0;
+
+    return stats;
+}
+
+Bana::String Bana::make_string(const char *cstr, Allocator allocator) {
+    String str;
+
+    str.length   = std::strlen(cstr);
+    str.capacity = str.length;
+    str.data     = (char *) allocator.alloc(str.capacity);
+
+    std::memcpy(str.data, cstr, str.length);
+
+    return str;
+}
+
+Bana::String Bana::make_string(const char *bytes, usize length, Allocator allocator) {
+    String str;
+
+    str.length   = length;
+    str.capacity = str.length;
+    str.data     = (char *) allocator.alloc(str.capacity);
+
+    std::memcpy(str.data, bytes, str.length);
+
+    return str;
+}
+
+Bana::String Bana::make_string(usize capacity, Allocator allocator) {
+    String str;
+
+    str.length   = 0;
+    str.capacity = capacity;
+    str.data     = (char *) allocator.alloc(str.capacity);
+
+    return str;
+}
+
+Bana::String Bana::make_string(const Bana::String &other, Allocator allocator) {
+    return make_string(other.data, other.length, allocator);
+}
+
+Bana::String Bana::make_formatted_string(Allocator allocator, const char *fmt, va_list args) {
+    // A va_list can only be walked once.
+    va_list measure_args;
+    va_copy(measure_args, args);
+    isize string_length = std::vsnprintf(nullptr, 0, fmt, measure_args) + 1;
+    va_end(measure_args);
+
+    String ret = make_string(string_length, allocator);
+
+    std::vsnprintf(ret.data, ret.capacity, fmt, args);
+    ret.length = string_length - 1;
+
+    return ret;
+}
+
+Bana::String Bana::temp_string(const char *bytes, usize length) {
+    String str;
+
+    str.length   = length;
+    str.capacity = str.length;
+    str.data     = (char *) bytes;
+
+    return str;
+}
+
+Bana::String Bana::temp_string(const char *cstr) {
+    String str;
+
+    str.length   = std::strlen(cstr);
+    str.capacity = str.length;
+    str.data     = (char *) cstr;
+
+    return str;
+}
+
+void Bana::free_string(String *str, Allocator allocator) {
+    allocator.free(str->data);
+    std::memset(str, 0, sizeof(String));
+}
+
+void Bana::string_concat(String &dst, const String &src) {
+    assert(dst.capacity >= dst.length + src.length);
+    std::memcpy(&dst.data[dst.length], src.data, src.length);
+    dst.length += src.length;
+}
+
+void Bana::string_concat(String &dst, char c) {
+    assert(dst.capacity >= dst.length + 1);
+    dst.data[dst.length] = c;
+    ++dst.length;
+}
+
+void Bana::string_concat(String &dst, const char *cstr) {
+    usize src_length = std::strlen(cstr);
+    assert(dst.capacity >= dst.length + src_length);
+    std::memcpy(&dst.data[dst.length], cstr, src_length);
+    dst.length += src_length;
+}
+
+static void string_format_va(Bana::String &dst, const char *fmt, va_list args) {
+    dst.length = 0;
+
+    isize ret = std::vsnprintf(dst.data, dst.capacity, fmt, args);
+
+    if (ret < 0 || ret > (isize) dst.capacity) return;
+
+    dst.length = ret;
+}
+
+// FIXME: standard vsnprintf null terminates the string.
+void Bana::string_format(String &dst, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    string_format_va(dst, fmt, args);
+    va_end(args);
+}
+
+void Bana::string_strip_whitespace(String &str) {
+    str.length = filter_whitespace(str.data, str.length);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BANA_X86_KERNELS
+
+#define SSE2_KERNEL __attribute__((target("sse2")))
+#define AVX2_KERNEL __attribute__((target("avx2")))
+
+SSE2_KERNEL static inline __m128i whitespace_mask_sse2(__m128i block) {
+    // ' ' or '\t'..'\r'. The second test is an unsigned (block - '\t') <= 4 done with min since SSE2 has no unsigned compare.
+    __m128i shifted = _mm_sub_epi8(block, _mm_set1_epi8('\t'));
+    __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+    return _mm_or_si128(control, _mm_cmpeq_epi8(block, _mm_set1_epi8(' ')));
+}
+
+AVX2_KERNEL static inline __m256i whitespace_mask_avx2(__m256i block) {
+    __m256i shifted = _mm256_sub_epi8(block, _mm256_set1_epi8('\t'));
+    __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(4)), shifted);
+    return _mm256_or_si256(control, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')));
+}
+#endif
+
+static isize find_byte_scalar(const char *data, usize length, char c) {
+    const char *match = (const char *) std::memchr(data, c, length);
+    return match ? match - data : -1;
+}
+
+static isize find_any_byte_scalar(const char *data, usize length, const char *set, usize set_length) {
+    bool table[256] = {};
+    for (usize i = 0; i < set_length; ++i) table[(u8) set[i]] = true;
+
+    for (usize i = 0; i < length; ++i) {
+        if (table[(u8) data[i]]) return i;
+    }
+
+    return -1;
+}
+
+static usize count_byte_scalar(const char *data, usize length, char c) {
+    usize count = 0;
+    for (usize i = 0; i < length; ++i) count += data[i] == c;
+    return count;
+}
+
+static isize find_whitespace_scalar(const char *data, usize length) {
+    for (usize i = 0; i < length; ++i) {
+        if (is_whitespace(data[i])) return i;
+    }
+
+    return -1;
+}
+
+static isize find_substring_scalar(const char *haystack, usize haystack_length, const char *needle, usize needle_length) {
+    if (needle_length == 0) return 0;
+    if (needle_length > haystack_length) return -1;
+
+    usize last_start = haystack_length - needle_length;
+    for (usize i = 0; i <= last_start;) {
+        const char *match = (const char *) std::memchr(haystack + i, needle[0], last_start - i + 1);
+        if (!match) return -1;
+
+        i = match - haystack;
+        if (std::memcmp(haystack + i + 1, needle + 1, needle_length - 1) == 0) return i;
+        ++i;
+    }
+
+    return -1;
+}
+
+static usize filter_whitespace_scalar(char *data, usize length) {
+    usize w = 0;
+    for (usize i = 0; i < length; ++i) {
+        if (!is_whitespace(data[i])) data[w++] = data[i];
+    }
+
+    return w;
+}
+
+#ifdef BANA_X86_KERNELS
+// Sets bigger than this are cheaper to test with the scalar lookup table than with one compare per set byte.
+#define FIND_ANY_MAX_SIMD_SET 8
+
+SSE2_KERNEL static isize find_byte_sse2(const char *data, usize length, char c) {
+    __m128i needle = _mm_set1_epi8(c);
+    usize i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        u32 m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (data + i)), needle));
+        if (m) return i + __builtin_ctz(m);
+    }
+
+    isize tail = find_byte_scalar(data + i, length - i, c);
+    return tail < 0 ? -1 : (isize) i + tail;
+}
+
+AVX2_KERNEL static isize find_byte_avx2(const char *data, usize length, char c) {
+    __m256i needle = _mm256_set1_epi8(c);
+    usize i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        u32 m = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (data + i)), needle));
+        if (m) return i + __builtin_ctz(m);
+    }
+
+    isize tail = find_byte_scalar(data + i, length - i, c);
+    return tail < 0 ? -1 : (isize) i + tail;
+}
+
+SSE2_KERNEL static usize count_byte_sse2(const char *data, usize length, char c) {
+    __m128i needle = _mm_set1_epi8(c);
+    usize count = 0, i = 0;
+
+    for (; i + 16 <= length; i += 16) {
+        count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (data + i)), needle)));
+    }
+
+    return count + count_byte_scalar(data + i, length - i, c);
+}
+
+AVX2_KERNEL static usize count_byte_avx2(const char *data, usize length, char c) {
+    __m256i needle = _mm256_set1_epi8(c);
+    usize count = 0, i = 0;
+
+    for (; i + 32 <= length; i += 32) {
+        count += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (data + i)), needle)));
+    }
+
+    return count + count_byte_scalar(data + i, length - i, c);
+}
+
+SSE2_KERNEL static isize find_any_byte_sse2(const char *data, usize length, const char *set, usize set_length) {
+    if (set_length > FIND_ANY_MAX_SIMD_SET) return find_any_byte_scalar(data, length, set, set_length);
+
+    usize i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *) (data + i));
+        __m128i hits  = _mm_setzero_si128();
+        for (usize j = 0; j < set_length; ++j) hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(set[j])));
+
+        u32 m = _mm_movemask_epi8(hits);
+        if (m) return i + __builtin_ctz(m);
+    }
+
+    isize tail = find_any_byte_scalar(data + i, length - i, set, set_length);
+    return tail < 0 ? -1 : (isize) i + tail;
+}
+
+AVX2_KERNEL static isize find_any_byte_avx2(const char *data, usize length, const char *set, usize set_length) {
+    if (set_length > FIND_ANY_MAX_SIMD_SET) return find_any_byte_scalar(data, length, set, set_length);
+
+    usize i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *) (data + i));
+        __m256i hits  = _mm256_setzero_si256();
+        for (usize j = 0; j < set_length; ++j) hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(set[j])));
+
+        u32 m = _mm256_movemask_epi8(hits);
+        if (m) return i + __builtin_ctz(m);
+    }
+
+    isize tail = find_any_byte_scalar(data + i, length - i, set, set_length);
+    return tail < 0 ? -1 : (isize) i + tail;
+}
+
+SSE2_KERNEL static isize find_whitespace_sse2(const char *data, usize length) {
+    usize i = 0;
+    for (; i + 16 <= length; i += 16) {
+        u32 m = _mm_movemask_epi8(whitespace_mask_sse2(_mm_loadu_si128((const __m128i *) (data + i))));
+        if (m) return i + __builtin_ctz(m);
+    }
+
+    isize tail = find_whitespace_scalar(data + i, length - i);
+    return tail < 0 ? -1 : (isize) i + tail;
+}
+
+AVX2_KERNEL static isize find_whitespace_avx2(const char *data, usize length) {
+    usize i = 0;
+    for (; i + 32 <= length; i += 32) {
+        u32 m = _mm256_movemask_epi8(whitespace_mask_avx2(_mm256_loadu_si256((const __m256i *) (data + i))));
+        if (m) return i + __builtin_ctz(m);
+    }
+
+    isize tail = find_whitespace_scalar(data + i, length - i);
+    return tail < 0 ? -1 : (isize) i + tail;
+}
+
+// Bit j of a block's mask is set when both needle[0] matches at i + j and needle[n - 1] matches at i + j + n - 1. The
+// loop only runs while both loads stay inside the haystack and the scalar search finishes off the rest.
+SSE2_KERNEL static isize find_substring_sse2(const char *haystack, usize haystack_length, const char *needle, usize needle_length) {
+    if (needle_length < 2) return needle_length == 0 ? 0 : find_byte_sse2(haystack, haystack_length, needle[0]);
+    if (needle_length > haystack_length) return -1;
+
+    __m128i first = _mm_set1_epi8(needle[0]);
+    __m128i last  = _mm_set1_epi8(needle[needle_length - 1]);
+    usize i = 0;
+
+    for (; i + needle_length - 1 + 16 <= haystack_length; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i *) (haystack + i));
+        __m128i block_last  = _mm_loadu_si128((const __m128i *) (haystack + i + needle_length - 1));
+        u32 m = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+
+        for (; m; m &= m - 1) {
+            usize candidate = i + __builtin_ctz(m);
+            if (std::memcmp(haystack + candidate + 1, needle + 1, needle_length - 2) == 0) return candidate;
+        }
+    }
+
+    isize tail = find_substring_scalar(haystack + i, haystack_length - i, needle, needle_length);
+    return tail < 0 ? -1 : (isize) i + tail;
+}
+
+AVX2_KERNEL static isize find_substring_avx2(const char *haystack, usize haystack_length, const char *needle, usize needle_length) {
+    if (needle_length < 2) return needle_length == 0 ? 0 : find_byte_avx2(haystack, haystack_length, needle[0]);
+    if (needle_length > haystack_length) return -1;
+
+    __m256i first = _mm256_set1_epi8(needle[0]);
+    __m256i last  = _mm256_set1_epi8(needle[needle_length - 1]);
+    usize i = 0;
+
+    for (; i + needle_length - 1 + 32 <= haystack_length; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i *) (haystack + i));
+        __m256i block_last  = _mm256_loadu_si256((const __m256i *) (haystack + i + needle_length - 1));
+        u32 m = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last)));
+
+        for (; m; m &= m - 1) {
+            usize candidate = i + __builtin_ctz(m);
+            if (std::memcmp(haystack + candidate + 1, needle + 1, needle_length - 2) == 0) return candidate;
+        }
+    }
+
+    isize tail = find_substring_scalar(haystack + i, haystack_length - i, needle, needle_length);
+    return tail < 0 ? -1 : (isize) i + tail;
+}
+
+// Blocks without whitespace are moved down whole. The write cursor never passes the read cursor and each block is
+// loaded before anything is stored over it, so the in place moves are safe.
+SSE2_KERNEL static usize filter_whitespace_sse2(char *data, usize length) {
+    usize w = 0, i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *) (data + i));
+        u32 m         = _mm_movemask_epi8(whitespace_mask_sse2(block));
+
+        if (m == 0) {
+            _mm_storeu_si128((__m128i *) (data + w), block);
+            w += 16;
+            continue;
+        }
+
+        for (u32 j = 0; j < 16; ++j) {
+            if (!(m & (1u << j))) data[w++] = data[i + j];
+        }
+    }
+
+    for (; i < length; ++i) {
+        if (!is_whitespace(data[i])) data[w++] = data[i];
+    }
+
+    return w;
+}
+
+AVX2_KERNEL static usize filter_whitespace_avx2(char *data, usize length) {
+    usize w = 0, i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *) (data + i));
+        u32 m         = _mm256_movemask_epi8(whitespace_mask_avx2(block));
+
+        if (m == 0) {
+            _mm256_storeu_si256((__m256i *) (data + w), block);
+            w += 32;
+            continue;
+        }
+
+        for (u32 j = 0; j < 32; ++j) {
+            if (!(m & (1u << j))) data[w++] = data[i + j];
+        }
+    }
+
+    for (; i < length; ++i) {
+        if (!is_whitespace(data[i])) data[w++] = data[i];
+    }
+
+    return w;
+}
+#endif
+
+// Each kernel pointer starts out at a resolver that picks the best implementation, swaps itself out and forwards the
+// call. Racing threads just resolve to the same answer. The pointers are read and written with relaxed atomics since
+// any thread can be the one resolving them; every value they can hold is a working kernel, so no ordering is needed.
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2,
+};
+
+static SimdLevel detect_simd_level() {
+#ifdef BANA_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SIMD_SSE2;
+#endif
+    return SIMD_SCALAR;
+}
+
+#ifdef BANA_X86_KERNELS
+#define SELECT_KERNEL(NAME) (level == SIMD_AVX2 ? NAME##_avx2 : level == SIMD_SSE2 ? NAME##_sse2 : NAME##_scalar)
+#else
+#define SELECT_KERNEL(NAME) NAME##_scalar
+#endif
+
+#define LOAD_KERNEL(KERNEL)         __atomic_load_n(&KERNEL, __ATOMIC_RELAXED)
+#define STORE_KERNEL(KERNEL, VALUE) __atomic_store_n(&KERNEL, (decltype(KERNEL)) (VALUE), __ATOMIC_RELAXED)
+
+using FindByteProc         = isize (const char *, usize, char);
+using CountByteProc        = usize (const char *, usize, char);
+using FindAnyByteProc      = isize (const char *, usize, const char *, usize);
+using FindWhitespaceProc   = isize (const char *, usize);
+using FilterWhitespaceProc = usize (char *, usize);
+using FindSubstringProc    = isize (const char *, usize, const char *, usize);
+
+static isize find_byte_resolve(const char *data, usize length, char c);
+static usize count_byte_resolve(const char *data, usize length, char c);
+static isize find_any_byte_resolve(const char *data, usize length, const char *set, usize set_length);
+static isize find_whitespace_resolve(const char *data, usize length);
+static usize filter_whitespace_resolve(char *data, usize length);
+static isize find_substring_resolve(const char *haystack, usize haystack_length, const char *needle, usize needle_length);
+
+static FindByteProc *find_byte_kernel                 = find_byte_resolve;
+static CountByteProc *count_byte_kernel               = count_byte_resolve;
+static FindAnyByteProc *find_any_byte_kernel          = find_any_byte_resolve;
+static FindWhitespaceProc *find_whitespace_kernel     = find_whitespace_resolve;
+static FilterWhitespaceProc *filter_whitespace_kernel = filter_whitespace_resolve;
+static FindSubstringProc *find_substring_kernel       = find_substring_resolve;
+
+static void resolve_string_kernels() {
+    [[maybe_unused]] SimdLevel level = detect_simd_level();
+    STORE_KERNEL(find_byte_kernel,         SELECT_KERNEL(find_byte));
+    STORE_KERNEL(count_byte_kernel,        SELECT_KERNEL(count_byte));
+    STORE_KERNEL(find_any_byte_kernel,     SELECT_KERNEL(find_any_byte));
+    STORE_KERNEL(find_whitespace_kernel,   SELECT_KERNEL(find_whitespace));
+    STORE_KERNEL(filter_whitespace_kernel, SELECT_KERNEL(filter_whitespace));
+    STORE_KERNEL(find_substring_kernel,    SELECT_KERNEL(find_substring));
+}
+
+static isize find_byte_resolve(const char *data, usize length, char c) {
+    resolve_string_kernels();
+    return LOAD_KERNEL(find_byte_kernel)(data, length, c);
+}
+
+static usize count_byte_resolve(const char *data, usize length, char c) {
+    resolve_string_kernels();
+    return LOAD_KERNEL(count_byte_kernel)(data, length, c);
+}
+
+static isize find_any_byte_resolve(const char *data, usize length, const char *set, usize set_length) {
+    resolve_string_kernels();
+    return LOAD_KERNEL(find_any_byte_kernel)(data, length, set, set_length);
+}
+
+static isize find_whitespace_resolve(const char *data, usize length) {
+    resolve_string_kernels();
+    return LOAD_KERNEL(find_whitespace_kernel)(data, length);
+}
+
+static usize filter_whitespace_resolve(char *data, usize length) {
+    resolve_string_kernels();
+    return LOAD_KERNEL(filter_whitespace_kernel)(data, length);
+}
+
+static isize find_substring_resolve(const char *haystack, usize haystack_length, const char *needle, usize needle_length) {
+    resolve_string_kernels();
+    return LOAD_KERNEL(find_substring_kernel)(haystack, haystack_length, needle, needle_length);
+}
+
+isize Bana::find_byte(const char *data, usize length, char c) {
+    return LOAD_KERNEL(find_byte_kernel)(data, length, c);
+}
+
+usize Bana::count_byte(const char *data, usize length, char c) {
+    return LOAD_KERNEL(count_byte_kernel)(data, length, c);
+}
+
+isize Bana::find_any_byte(const char *data, usize length, const char *set, usize set_length) {
+    return LOAD_KERNEL(find_any_byte_kernel)(data, length, set, set_length);
+}
+
+isize Bana::find_whitespace(const char *data, usize length) {
+    return LOAD_KERNEL(find_whitespace_kernel)(data, length);
+}
+
+usize Bana::filter_whitespace(char *data, usize length) {
+    return LOAD_KERNEL(filter_whitespace_kernel)(data, length);
+}
+
+isize Bana::find_substring(const char *haystack, usize haystack_length, const char *needle, usize needle_length) {
+    return LOAD_KERNEL(find_substring_kernel)(haystack, haystack_length, needle, needle_length);
+}
+
+// Trimming stops at the first non-whitespace byte from either end, which is almost always within a few bytes, so
+// there is nothing for a vector loop to win here.
+Bana::String Bana::string_trim(const String &str) {
+    usize start = 0;
+    usize end   = str.length;
+
+    while (start < end && is_whitespace(str.data[start])) ++start;
+    while (end > start && is_whitespace(str.data[end - 1])) --end;
+
+    return temp_string(str.data + start, end - start);
+}
+
+isize Bana::string_split(const String &str, char delimiter, Array<String> &out) {
+    isize count = 0;
+    usize start = 0;
+
+    for (;;) {
+        isize i = find_byte(str.data + start, str.length - start, delimiter);
+        if (i < 0) break;
+
+        out.append(temp_string(str.data + start, i));
+        start += i + 1;
+        ++count;
+    }
+
+    out.append(temp_string(str.data + start, str.length - start));
+    return count + 1;
+}
+
+// Never let a chunk chain get longer than this per growth step.
+#define STRING_BUILDER_MAX_CHUNK MEGABYTES(1)
+
+Bana::StringBuilder Bana::make_string_builder(usize chunk_size, Allocator allocator) {
+    StringBuilder sb = {};
+
+    sb.chunk_size = chunk_size;
+    sb.allocator  = allocator;
+
+    return sb;
+}
+
+void Bana::free_string_builder(StringBuilder *sb) {
+    for (StringChunk *chunk = sb->first; chunk;) {
+        StringChunk *next = chunk->next;
+        sb->allocator.free(chunk);
+        chunk = next;
+    }
+
+    sb->first  = nullptr;
+    sb->last   = nullptr;
+    sb->length = 0;
+}
+
+char *Bana::StringBuilder::reserve(usize count) {
+    if (last && last->capacity - last->length >= count) return last->data() + last->length;
+
+    usize capacity = MAX(chunk_size, count);
+    StringChunk *chunk = (StringChunk *) allocator.alloc(sizeof(StringChunk) + capacity);
+    chunk->next        = nullptr;
+    chunk->length      = 0;
+    chunk->capacity    = capacity;
+
+    if (last) last->next = chunk;
+    else      first      = chunk;
+    last = chunk;
+
+    // Geometric growth keeps the chunk count logarithmic in the output size.
+    chunk_size = MIN(chunk_size * 2, (usize) STRING_BUILDER_MAX_CHUNK);
+
+    return chunk->data();
+}
+
+void Bana::StringBuilder::append(const char *bytes, usize count) {
+    // Fill whatever is left of the current chunk before starting a new one.
+    if (last) {
+        usize spare = MIN(count, last->capacity - last->length);
+        std::memcpy(last->data() + last->length, bytes, spare);
+        commit(spare);
+        bytes += spare;
+        count -= spare;
+    }
+
+    if (count == 0) return;
+
+    std::memcpy(reserve(count), bytes, count);
+    commit(count);
+}
+
+void Bana::StringBuilder::append(const String &str) {
+    append(str.data, str.length);
+}
+
+void Bana::StringBuilder::append(const char *cstr) {
+    append(cstr, std::strlen(cstr));
+}
+
+void Bana::StringBuilder::append(char c) {
+    *reserve(1) = c;
+    commit(1);
+}
+
+static const char decimal_digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Writes the digits of value ending just before end and returns where they start.
+static char *format_u64_backwards(char *end, u64 value) {
+    while (value >= 100) {
+        u64 pair = (value % 100) * 2;
+        value   /= 100;
+        *--end   = decimal_digit_pairs[pair + 1];
+        *--end   = decimal_digit_pairs[pair];
+    }
+
+    if (value >= 10) {
+        *--end = decimal_digit_pairs[value * 2 + 1];
+        *--end = decimal_digit_pairs[value * 2];
+    } else {
+        *--end = '0' + (char) value;
+    }
+
+    return end;
+}
+
+void Bana::StringBuilder::append_u64(u64 value) {
+    char buf[20];
+    char *start = format_u64_backwards(buf + sizeof(buf), value);
+    append(start, buf + sizeof(buf) - start);
+}
+
+void Bana::StringBuilder::append_i64(i64 value) {
+    if (value < 0) {
+        append('-');
+        append_u64(~(u64) value + 1);
+    } else {
+        append_u64(value);
+    }
+}
+
+static void append_f64_exact(Bana::StringBuilder *builder, u64 mantissa, i32 exponent, u32 precision);
+
+// Same digits as printf's %.*f: fixed point at every magnitude, rounded half to even on the exact binary value.
+void Bana::StringBuilder::append_f64(f64 value, u32 precision) {
+    static const u64 powers_of_ten[] = {
+        1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull, 1000000000ull,
+        10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull, 100000000000000ull, 1000000000000000ull,
+        10000000000000000ull, 100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+    };
+
+    if (value != value) return append("nan");
+    if (std::signbit(value)) {
+        append('-');
+        value = -value;
+    }
+
+    if (value == HUGE_VAL) return append("inf");
+
+    // value is exactly mantissa * 2^exponent.
+    u64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    u64 mantissa = bits & ((1ull << 52) - 1);
+    i32 exponent = (i32) (bits >> 52);
+    if (exponent == 0) exponent = 1;
+    else               mantissa |= 1ull << 52;
+    exponent -= 1075;
+
+    // Below 2^64 with at most 19 digits, mantissa * 10^precision fits in 128 bits and the rounding can be done there.
+    // Anything else goes through a big decimal.
+    if (precision >= ARRAY_LEN(powers_of_ten) || exponent > 11) return append_f64_exact(this, mantissa, exponent, precision);
+
+    u64 scale = powers_of_ten[precision];
+    unsigned __int128 scaled;
+    if (exponent >= 0) {
+        scaled = (unsigned __int128) (mantissa << exponent) * scale;
+    } else if (-exponent > 117) {
+        // mantissa * scale < 2^117, less than half of 2^-exponent.
+        scaled = 0;
+    } else {
+        unsigned __int128 n         = (unsigned __int128) mantissa * scale;
+        unsigned __int128 half      = (unsigned __int128) 1 << (-exponent - 1);
+        unsigned __int128 remainder = n & ((half << 1) - 1);
+        scaled                      = n >> -exponent;
+        if (remainder > half || (remainder == half && (scaled & 1))) ++scaled;
+    }
+
+    append_u64((u64) (scaled / scale));
+    if (precision == 0) return;
+
+    char buf[19];
+    char *end   = buf + precision;
+    char *start = format_u64_backwards(end, (u64) (scaled % scale));
+    while (start > buf) *--start = '0';
+
+    append('.');
+    append(buf, precision);
+}
+
+void Bana::StringBuilder::appendf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+
+    va_list retry_args;
+    va_copy(retry_args, args);
+
+    // Format straight into the spare capacity of the current chunk. Only if that is too small do we format again,
+    // into a chunk we know is big enough.
+    usize spare = last ? last->capacity - last->length : 0;
+    char *dst   = last ? last->data() + last->length : nullptr;
+    isize ret   = std::vsnprintf(dst, spare, fmt, args);
+    va_end(args);
+
+    if (ret < 0) {
+        va_end(retry_args);
+        return;
+    }
+
+    // vsnprintf always wants room for a null terminator, even though we do not keep it.
+    if ((usize) ret >= spare) {
+        dst = reserve(ret + 1);
+        std::vsnprintf(dst, ret + 1, fmt, retry_args);
+    }
+
+    va_end(retry_args);
+    commit(ret);
+}
+
+isize Bana::StringBuilder::gather(String *views, isize max_views) {
+    isize count = 0;
+    for (StringChunk *chunk = first; chunk && count < max_views; chunk = chunk->next) {
+        if (chunk->length == 0) continue;
+        views[count++] = temp_string(chunk->data(), chunk->length);
+    }
+
+    return count;
+}
+
+Bana::String Bana::StringBuilder::to_string(Allocator allocator) {
+    String ret = make_string(length, allocator);
+
+    for (StringChunk *chunk = first; chunk; chunk = chunk->next) {
+        std::memcpy(ret.data + ret.length, chunk->data(), chunk->length);
+        ret.length += chunk->length;
+    }
+
+    return ret;
+}
+
+void Bana::StringBuilder::reset() {
+    if (!first) return;
+
+    for (StringChunk *chunk = first->next; chunk;) {
+        StringChunk *next = chunk->next;
+        allocator.free(chunk);
+        chunk = next;
+    }
+
+    first->next   = nullptr;
+    first->length = 0;
+    last          = first;
+    length        = 0;
+}
+
+u32 Bana::parse_hex_u32(String str) {
+    u32 res = 0;
+    for (usize i = 0; i < str.length; ++i) {
+        res *= 16;
+        if      (str.data[i] >= 'A' && str.data[i] <= 'F') res += str.data[i] - 'A' + 10;
+        else if (str.data[i] >= 'a' && str.data[i] <= 'f') res += str.data[i] - 'a' + 10;
+        else if (str.data[i] >= '0' && str.data[i] <= '9') res += str.data[i] - '0';
+        else return 0;
+    }
+
+    return res;
+}
+
+static inline bool is_digit(char c) {
+    return (u8) (c - '0') < 10;
+}
+
+// SWAR: true if all 8 bytes are ASCII digits.
+static inline bool is_eight_digits(u64 chunk) {
+    return (((chunk & 0xF0F0F0F0F0F0F0F0ull) | (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull);
+}
+
+// SWAR: value of 8 ASCII digits read as a little endian u64, most significant digit first.
+static inline u32 parse_eight_digits(u64 chunk) {
+    const u64 mask = 0x000000FF000000FFull;
+    const u64 mul1 = 0x000F424000000064ull; // 100 + (1000000 << 32)
+    const u64 mul2 = 0x0000271000000001ull; // 1 + (10000 << 32)
+
+    chunk -= 0x3030303030303030ull;
+    chunk  = (chunk * 10) + (chunk >> 8);
+    chunk  = (((chunk & mask) * mul1) + (((chunk >> 16) & mask) * mul2)) >> 32;
+    return (u32) chunk;
+}
+
+// Accumulate digits into *value eight at a time where possible. Returns how many digits were consumed. The caller is
+// responsible for overflow, so at most max_digits are read.
+static inline usize accumulate_digits(const char *data, usize length, u64 *value, usize max_digits) {
+    usize i = 0;
+    u64 v   = *value;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (i + 8 <= length && i + 8 <= max_digits) {
+        u64 chunk;
+        std::memcpy(&chunk, data + i, sizeof(u64));
+        if (!is_eight_digits(chunk)) break;
+
+        v  = v * 100000000 + parse_eight_digits(chunk);
+        i += 8;
+    }
+#endif
+
+    for (; i < length && i < max_digits && is_digit(data[i]); ++i) v = v * 10 + (data[i] - '0');
+
+    *value = v;
+    return i;
+}
+
+usize Bana::parse_u64_prefix(const char *data, usize length, u64 *out) {
+    u64 value = 0;
+
+    // Leading zeros do not count towards overflow.
+    usize zeros = 0;
+    while (zeros < length && data[zeros] == '0') ++zeros;
+
+    // 19 digits always fit. A 20th might, if it does not overflow.
+    usize i = zeros + accumulate_digits(data + zeros, length - zeros, &value, 19);
+    if (i == 0) return 0;
+
+    if (i < length && is_digit(data[i])) {
+        if (__builtin_mul_overflow(value, 10, &value) || __builtin_add_overflow(value, (u64) (data[i] - '0'), &value)) return 0;
+        ++i;
+        if (i < length && is_digit(data[i])) return 0;
+    }
+
+    *out = value;
+    return i;
+}
+
+usize Bana::parse_i64_prefix(const char *data, usize length, i64 *out) {
+    usize i       = 0;
+    bool negative = false;
+
+    if (i < length && (data[i] == '-' || data[i] == '+')) {
+        negative = data[i] == '-';
+        ++i;
+    }
+
+    u64 magnitude;
+    usize digits = parse_u64_prefix(data + i, length - i, &magnitude);
+    if (digits == 0) return 0;
+
+    if (negative) {
+        if (magnitude > (u64) INT64_MAX + 1) return 0;
+        *out = (i64) (~magnitude + 1);
+    } else {
+        if (magnitude > (u64) INT64_MAX) return 0;
+        *out = (i64) magnitude;
+    }
+
+    return i + digits;
+}
+
+// Truncated 128 bit approximations of 5^q for q in [-342, 308], normalized so the top bit is set. Used by the
+// Eisel-Lemire algorithm below (Lemire, "Number Parsing at a Gigabyte per Second", 2021).
+static const u64 power_of_five_128[1302] = {
+    0xeef453d6923bd65aull, 0x113faa2906a13b3full,
+    0x9558b4661b6565f8ull, 0x4ac7ca59a424c507ull,
+    0xbaaee17fa23ebf76ull, 0x5d79bcf00d2df649ull,
+    0xe95a99df8ace6f53ull, 0xf4d82c2c107973dcull,
+    0x91d8a02bb6c10594ull, 0x79071b9b8a4be869ull,
+    0xb64ec836a47146f9ull, 0x9748e2826cdee284ull,
+    0xe3e27a444d8d98b7ull, 0xfd1b1b2308169b25ull,
+    0x8e6d8c6ab0787f72ull, 0xfe30f0f5e50e20f7ull,
+    0xb208ef855c969f4full, 0xbdbd2d335e51a935ull,
+    0xde8b2b66b3bc4723ull, 0xad2c788035e61382ull,
+    0x8b16fb203055ac76ull, 0x4c3bcb5021afcc31ull,
+    0xaddcb9e83c6b1793ull, 0xdf4abe242a1bbf3dull,
+    0xd953e8624b85dd78ull, 0xd71d6dad34a2af0dull,
+    0x87d4713d6f33aa6bull, 0x8672648c40e5ad68ull,
+    0xa9c98d8ccb009506ull, 0x680efdaf511f18c2ull,
+    0xd43bf0effdc0ba48ull, 0x0212bd1b2566def2ull,
+    0x84a57695fe98746dull, 0x014bb630f7604b57ull,
+    0xa5ced43b7e3e9188ull, 0x419ea3bd35385e2dull,
+    0xcf42894a5dce35eaull, 0x52064cac828675b9ull,
+    0x818995ce7aa0e1b2ull, 0x7343efebd1940993ull,
+    0xa1ebfb4219491a1full, 0x1014ebe6c5f90bf8ull,
+    0xca66fa129f9b60a6ull, 0xd41a26e077774ef6ull,
+    0xfd00b897478238d0ull, 0x8920b098955522b4ull,
+    0x9e20735e8cb16382ull, 0x55b46e5f5d5535b0ull,
+    0xc5a890362fddbc62ull, 0xeb2189f734aa831dull,
+    0xf712b443bbd52b7bull, 0xa5e9ec7501d523e4ull,
+    0x9a6bb0aa55653b2dull, 0x47b233c92125366eull,
+    0xc1069cd4eabe89f8ull, 0x999ec0bb696e840aull,
+    0xf148440a256e2c76ull, 0xc00670ea43ca250dull,
+    0x96cd2a865764dbcaull, 0x380406926a5e5728ull,
+    0xbc807527ed3e12bcull, 0xc605083704f5ecf2ull,
+    0xeba09271e88d976bull, 0xf7864a44c633682eull,
+    0x93445b8731587ea3ull, 0x7ab3ee6afbe0211dull,
+    0xb8157268fdae9e4cull, 0x5960ea05bad82964ull,
+    0xe61acf033d1a45dfull, 0x6fb92487298e33bdull,
+    0x8fd0c16206306babull, 0xa5d3b6d479f8e056ull,
+    0xb3c4f1ba87bc8696ull, 0x8f48a4899877186cull,
+    0xe0b62e2929aba83cull, 0x331acdabfe94de87ull,
+    0x8c71dcd9ba0b4925ull, 0x9ff0c08b7f1d0b14ull,
+    0xaf8e5410288e1b6full, 0x07ecf0ae5ee44dd9ull,
+    0xdb71e91432b1a24aull, 0xc9e82cd9f69d6150ull,
+    0x892731ac9faf056eull, 0xbe311c083a225cd2ull,
+    0xab70fe17c79ac6caull, 0x6dbd630a48aaf406ull,
+    0xd64d3d9db981787dull, 0x092cbbccdad5b108ull,
+    0x85f0468293f0eb4eull, 0x25bbf56008c58ea5ull,
+    0xa76c582338ed2621ull, 0xaf2af2b80af6f24eull,
+    0xd1476e2c07286faaull, 0x1af5af660db4aee1ull,
+    0x82cca4db847945caull, 0x50d98d9fc890ed4dull,
+    0xa37fce126597973cull, 0xe50ff107bab528a0ull,
+    0xcc5fc196fefd7d0cull, 0x1e53ed49a96272c8ull,
+    0xff77b1fcbebcdc4full, 0x25e8e89c13bb0f7aull,
+    0x9faacf3df73609b1ull, 0x77b191618c54e9acull,
+    0xc795830d75038c1dull, 0xd59df5b9ef6a2417ull,
+    0xf97ae3d0d2446f25ull, 0x4b0573286b44ad1dull,
+    0x9becce62836ac577ull, 0x4ee367f9430aec32ull,
+    0xc2e801fb244576d5ull, 0x229c41f793cda73full,
+    0xf3a20279ed56d48aull, 0x6b43527578c1110full,
+    0x9845418c345644d6ull, 0x830a13896b78aaa9ull,
+    0xbe5691ef416bd60cull, 0x23cc986bc656d553ull,
+    0xedec366b11c6cb8full, 0x2cbfbe86b7ec8aa8ull,
+    0x94b3a202eb1c3f39ull, 0x7bf7d71432f3d6a9ull,
+    0xb9e08a83a5e34f07ull, 0xdaf5ccd93fb0cc53ull,
+    0xe858ad248f5c22c9ull, 0xd1b3400f8f9cff68ull,
+    0x91376c36d99995beull, 0x23100809b9c21fa1ull,
+    0xb58547448ffffb2dull, 0xabd40a0c2832a78aull,
+    0xe2e69915b3fff9f9ull, 0x16c90c8f323f516cull,
+    0x8dd01fad907ffc3bull, 0xae3da7d97f6792e3ull,
+    0xb1442798f49ffb4aull, 0x99cd11cfdf41779cull,
+    0xdd95317f31c7fa1dull, 0x40405643d711d583ull,
+    0x8a7d3eef7f1cfc52ull, 0x482835ea666b2572ull,
+    0xad1c8eab5ee43b66ull, 0xda3243650005eecfull,
+    0xd863b256369d4a40ull, 0x90bed43e40076a82ull,
+    0x873e4f75e2224e68ull, 0x5a7744a6e804a291ull,
+    0xa90de3535aaae202ull, 0x711515d0a205cb36ull,
+    0xd3515c2831559a83ull, 0x0d5a5b44ca873e03ull,
+    0x8412d9991ed58091ull, 0xe858790afe9486c2ull,
+    0xa5178fff668ae0b6ull, 0x626e974dbe39a872ull,
+    0xce5d73ff402d98e3ull, 0xfb0a3d212dc8128full,
+    0x80fa687f881c7f8eull, 0x7ce66634bc9d0b99ull,
+    0xa139029f6a239f72ull, 0x1c1fffc1ebc44e80ull,
+    0xc987434744ac874eull, 0xa327ffb266b56220ull,
+    0xfbe9141915d7a922ull, 0x4bf1ff9f0062baa8ull,
+    0x9d71ac8fada6c9b5ull, 0x6f773fc3603db4a9ull,
+    0xc4ce17b399107c22ull, 0xcb550fb4384d21d3ull,
+    0xf6019da07f549b2bull, 0x7e2a53a146606a48ull,
+    0x99c102844f94e0fbull, 0x2eda7444cbfc426dull,
+    0xc0314325637a1939ull, 0xfa911155fefb5308ull,
+    0xf03d93eebc589f88ull, 0x793555ab7eba27caull,
+    0x96267c7535b763b5ull, 0x4bc1558b2f3458deull,
+    0xbbb01b9283253ca2ull, 0x9eb1aaedfb016f16ull,
+    0xea9c227723ee8bcbull, 0x465e15a979c1cadcull,
+    0x92a1958a7675175full, 0x0bfacd89ec191ec9ull,
+    0xb749faed14125d36ull, 0xcef980ec671f667bull,
+    0xe51c79a85916f484ull, 0x82b7e12780e7401aull,
+    0x8f31cc0937ae58d2ull, 0xd1b2ecb8b0908810ull,
+    0xb2fe3f0b8599ef07ull, 0x861fa7e6dcb4aa15ull,
+    0xdfbdcece67006ac9ull, 0x67a791e093e1d49aull,
+    0x8bd6a141006042bdull, 0xe0c8bb2c5c6d24e0ull,
+    0xaecc49914078536dull, 0x58fae9f773886e18ull,
+    0xda7f5bf590966848ull, 0xaf39a475506a899eull,
+    0x888f99797a5e012dull, 0x6d8406c952429603ull,
+    0xaab37fd7d8f58178ull, 0xc8e5087ba6d33b83ull,
+    0xd5605fcdcf32e1d6ull, 0xfb1e4a9a90880a64ull,
+    0x855c3be0a17fcd26ull, 0x5cf2eea09a55067full,
+    0xa6b34ad8c9dfc06full, 0xf42faa48c0ea481eull,
+    0xd0601d8efc57b08bull, 0xf13b94daf124da26ull,
+    0x823c12795db6ce57ull, 0x76c53d08d6b70858ull,
+    0xa2cb1717b52481edull, 0x54768c4b0c64ca6eull,
+    0xcb7ddcdda26da268ull, 0xa9942f5dcf7dfd09ull,
+    0xfe5d54150b090b02ull, 0xd3f93b35435d7c4cull,
+    0x9efa548d26e5a6e1ull, 0xc47bc5014a1a6dafull,
+    0xc6b8e9b0709f109aull, 0x359ab6419ca1091bull,
+    0xf867241c8cc6d4c0ull, 0xc30163d203c94b62ull,
+    0x9b407691d7fc44f8ull, 0x79e0de63425dcf1dull,
+    0xc21094364dfb5636ull, 0x985915fc12f542e4ull,
+    0xf294b943e17a2bc4ull, 0x3e6f5b7b17b2939dull,
+    0x979cf3ca6cec5b5aull, 0xa705992ceecf9c42ull,
+    0xbd8430bd08277231ull, 0x50c6ff782a838353ull,
+    0xece53cec4a314ebdull, 0xa4f8bf5635246428ull,
+    0x940f4613ae5ed136ull, 0x871b7795e136be99ull,
+    0xb913179899f68584ull, 0x28e2557b59846e3full,
+    0xe757dd7ec07426e5ull, 0x331aeada2fe589cfull,
+    0x9096ea6f3848984full, 0x3ff0d2c85def7621ull,
+    0xb4bca50b065abe63ull, 0x0fed077a756b53a9ull,
+    0xe1ebce4dc7f16dfbull, 0xd3e8495912c62894ull,
+    0x8d3360f09cf6e4bdull, 0x64712dd7abbbd95cull,
+    0xb080392cc4349decull, 0xbd8d794d96aacfb3ull,
+    0xdca04777f541c567ull, 0xecf0d7a0fc5583a0ull,
+    0x89e42caaf9491b60ull, 0xf41686c49db57244ull,
+    0xac5d37d5b79b6239ull, 0x311c2875c522ced5ull,
+    0xd77485cb25823ac7ull, 0x7d633293366b828bull,
+    0x86a8d39ef77164bcull, 0xae5dff9c02033197ull,
+    0xa8530886b54dbdebull, 0xd9f57f830283fdfcull,
+    0xd267caa862a12d66ull, 0xd072df63c324fd7bull,
+    0x8380dea93da4bc60ull, 0x4247cb9e59f71e6dull,
+    0xa46116538d0deb78ull, 0x52d9be85f074e608ull,
+    0xcd795be870516656ull, 0x67902e276c921f8bull,
+    0x806bd9714632dff6ull, 0x00ba1cd8a3db53b6ull,
+    0xa086cfcd97bf97f3ull, 0x80e8a40eccd228a4ull,
+    0xc8a883c0fdaf7df0ull, 0x6122cd128006b2cdull,
+    0xfad2a4b13d1b5d6cull, 0x796b805720085f81ull,
+    0x9cc3a6eec6311a63ull, 0xcbe3303674053bb0ull,
+    0xc3f490aa77bd60fcull, 0xbedbfc4411068a9cull,
+    0xf4f1b4d515acb93bull, 0xee92fb5515482d44ull,
+    0x991711052d8bf3c5ull, 0x751bdd152d4d1c4aull,
+    0xbf5cd54678eef0b6ull, 0xd262d45a78a0635dull,
+    0xef340a98172aace4ull, 0x86fb897116c87c34ull,
+    0x9580869f0e7aac0eull, 0xd45d35e6ae3d4da0ull,
+    0xbae0a846d2195712ull, 0x8974836059cca109ull,
+    0xe998d258869facd7ull, 0x2bd1a438703fc94bull,
+    0x91ff83775423cc06ull, 0x7b6306a34627ddcfull,
+    0xb67f6455292cbf08ull, 0x1a3bc84c17b1d542ull,
+    0xe41f3d6a7377eecaull, 0x20caba5f1d9e4a93ull,
+    0x8e938662882af53eull, 0x547eb47b7282ee9cull,
+    0xb23867fb2a35b28dull, 0xe99e619a4f23aa43ull,
+    0xdec681f9f4c31f31ull, 0x6405fa00e2ec94d4ull,
+    0x8b3c113c38f9f37eull, 0xde83bc408dd3dd04ull,
+    0xae0b158b4738705eull, 0x9624ab50b148d445ull,
+    0xd98ddaee19068c76ull, 0x3badd624dd9b0957ull,
+    0x87f8a8d4cfa417c9ull, 0xe54ca5d70a80e5d6ull,
+    0xa9f6d30a038d1dbcull, 0x5e9fcf4ccd211f4cull,
+    0xd47487cc8470652bull, 0x7647c3200069671full,
+    0x84c8d4dfd2c63f3bull, 0x29ecd9f40041e073ull,
+    0xa5fb0a17c777cf09ull, 0xf468107100525890ull,
+    0xcf79cc9db955c2ccull, 0x7182148d4066eeb4ull,
+    0x81ac1fe293d599bfull, 0xc6f14cd848405530ull,
+    0xa21727db38cb002full, 0xb8ada00e5a506a7cull,
+    0xca9cf1d206fdc03bull, 0xa6d90811f0e4851cull,
+    0xfd442e4688bd304aull, 0x908f4a166d1da663ull,
+    0x9e4a9cec15763e2eull, 0x9a598e4e043287feull,
+    0xc5dd44271ad3cdbaull, 0x40eff1e1853f29fdull,
+    0xf7549530e188c128ull, 0xd12bee59e68ef47cull,
+    0x9a94dd3e8cf578b9ull, 0x82bb74f8301958ceull,
+    0xc13a148e3032d6e7ull, 0xe36a52363c1faf01ull,
+    0xf18899b1bc3f8ca1ull, 0xdc44e6c3cb279ac1ull,
+    0x96f5600f15a7b7e5ull, 0x29ab103a5ef8c0b9ull,
+    0xbcb2b812db11a5deull, 0x7415d448f6b6f0e7ull,
+    0xebdf661791d60f56ull, 0x111b495b3464ad21ull,
+    0x936b9fcebb25c995ull, 0xcab10dd900beec34ull,
+    0xb84687c269ef3bfbull, 0x3d5d514f40eea742ull,
+    0xe65829b3046b0afaull, 0x0cb4a5a3112a5112ull,
+    0x8ff71a0fe2c2e6dcull, 0x47f0e785eaba72abull,
+    0xb3f4e093db73a093ull, 0x59ed216765690f56ull,
+    0xe0f218b8d25088b8ull, 0x306869c13ec3532cull,
+    0x8c974f7383725573ull, 0x1e414218c73a13fbull,
+    0xafbd2350644eeacfull, 0xe5d1929ef90898faull,
+    0xdbac6c247d62a583ull, 0xdf45f746b74abf39ull,
+    0x894bc396ce5da772ull, 0x6b8bba8c328eb783ull,
+    0xab9eb47c81f5114full, 0x066ea92f3f326564ull,
+    0xd686619ba27255a2ull, 0xc80a537b0efefebdull,
+    0x8613fd0145877585ull, 0xbd06742ce95f5f36ull,
+    0xa798fc4196e952e7ull, 0x2c48113823b73704ull,
+    0xd17f3b51fca3a7a0ull, 0xf75a15862ca504c5ull,
+    0x82ef85133de648c4ull, 0x9a984d73dbe722fbull,
+    0xa3ab66580d5fdaf5ull, 0xc13e60d0d2e0ebbaull,
+    0xcc963fee10b7d1b3ull, 0x318df905079926a8ull,
+    0xffbbcfe994e5c61full, 0xfdf17746497f7052ull,
+    0x9fd561f1fd0f9bd3ull, 0xfeb6ea8bedefa633ull,
+    0xc7caba6e7c5382c8ull, 0xfe64a52ee96b8fc0ull,
+    0xf9bd690a1b68637bull, 0x3dfdce7aa3c673b0ull,
+    0x9c1661a651213e2dull, 0x06bea10ca65c084eull,
+    0xc31bfa0fe5698db8ull, 0x486e494fcff30a62ull,
+    0xf3e2f893dec3f126ull, 0x5a89dba3c3efccfaull,
+    0x986ddb5c6b3a76b7ull, 0xf89629465a75e01cull,
+    0xbe89523386091465ull, 0xf6bbb397f1135823ull,
+    0xee2ba6c0678b597full, 0x746aa07ded582e2cull,
+    0x94db483840b717efull, 0xa8c2a44eb4571cdcull,
+    0xba121a4650e4ddebull, 0x92f34d62616ce413ull,
+    0xe896a0d7e51e1566ull, 0x77b020baf9c81d17ull,
+    0x915e2486ef32cd60ull, 0x0ace1474dc1d122eull,
+    0xb5b5ada8aaff80b8ull, 0x0d819992132456baull,
+    0xe3231912d5bf60e6ull, 0x10e1fff697ed6c69ull,
+    0x8df5efabc5979c8full, 0xca8d3ffa1ef463c1ull,
+    0xb1736b96b6fd83b3ull, 0xbd308ff8a6b17cb2ull,
+    0xddd0467c64bce4a0ull, 0xac7cb3f6d05ddbdeull,
+    0x8aa22c0dbef60ee4ull, 0x6bcdf07a423aa96bull,
+    0xad4ab7112eb3929dull, 0x86c16c98d2c953c6ull,
+    0xd89d64d57a607744ull, 0xe871c7bf077ba8b7ull,
+    0x87625f056c7c4a8bull, 0x11471cd764ad4972ull,
+    0xa93af6c6c79b5d2dull, 0xd598e40d3dd89bcfull,
+    0xd389b47879823479ull, 0x4aff1d108d4ec2c3ull,
+    0x843610cb4bf160cbull, 0xcedf722a585139baull,
+    0xa54394fe1eedb8feull, 0xc2974eb4ee658828ull,
+    0xce947a3da6a9273eull, 0x733d226229feea32ull,
+    0x811ccc668829b887ull, 0x0806357d5a3f525full,
+    0xa163ff802a3426a8ull, 0xca07c2dcb0cf26f7ull,
+    0xc9bcff6034c13052ull, 0xfc89b393dd02f0b5ull,
+    0xfc2c3f3841f17c67ull, 0xbbac2078d443ace2ull,
+    0x9d9ba7832936edc0ull, 0xd54b944b84aa4c0dull,
+    0xc5029163f384a931ull, 0x0a9e795e65d4df11ull,
+    0xf64335bcf065d37dull, 0x4d4617b5ff4a16d5ull,
+    0x99ea0196163fa42eull, 0x504bced1bf8e4e45ull,
+    0xc06481fb9bcf8d39ull, 0xe45ec2862f71e1d6ull,
+    0xf07da27a82c37088ull, 0x5d767327bb4e5a4cull,
+    0x964e858c91ba2655ull, 0x3a6a07f8d510f86full,
+    0xbbe226efb628afeaull, 0x890489f70a55368bull,
+    0xeadab0aba3b2dbe5ull, 0x2b45ac74ccea842eull,
+    0x92c8ae6b464fc96full, 0x3b0b8bc90012929dull,
+    0xb77ada0617e3bbcbull, 0x09ce6ebb40173744ull,
+    0xe55990879ddcaabdull, 0xcc420a6a101d0515ull,
+    0x8f57fa54c2a9eab6ull, 0x9fa946824a12232dull,
+    0xb32df8e9f3546564ull, 0x47939822dc96abf9ull,
+    0xdff9772470297ebdull, 0x59787e2b93bc56f7ull,
+    0x8bfbea76c619ef36ull, 0x57eb4edb3c55b65aull,
+    0xaefae51477a06b03ull, 0xede622920b6b23f1ull,
+    0xdab99e59958885c4ull, 0xe95fab368e45ecedull,
+    0x88b402f7fd75539bull, 0x11dbcb0218ebb414ull,
+    0xaae103b5fcd2a881ull, 0xd652bdc29f26a119ull,
+    0xd59944a37c0752a2ull, 0x4be76d3346f0495full,
+    0x857fcae62d8493a5ull, 0x6f70a4400c562ddbull,
+    0xa6dfbd9fb8e5b88eull, 0xcb4ccd500f6bb952ull,
+    0xd097ad07a71f26b2ull, 0x7e2000a41346a7a7ull,
+    0x825ecc24c873782full, 0x8ed400668c0c28c8ull,
+    0xa2f67f2dfa90563bull, 0x728900802f0f32faull,
+    0xcbb41ef979346bcaull, 0x4f2b40a03ad2ffb9ull,
+    0xfea126b7d78186bcull, 0xe2f610c84987bfa8ull,
+    0x9f24b832e6b0f436ull, 0x0dd9ca7d2df4d7c9ull,
+    0xc6ede63fa05d3143ull, 0x91503d1c79720dbbull,
+    0xf8a95fcf88747d94ull, 0x75a44c6397ce912aull,
+    0x9b69dbe1b548ce7cull, 0xc986afbe3ee11abaull,
+    0xc24452da229b021bull, 0xfbe85badce996168ull,
+    0xf2d56790ab41c2a2ull, 0xfae27299423fb9c3ull,
+    0x97c560ba6b0919a5ull, 0xdccd879fc967d41aull,
+    0xbdb6b8e905cb600full, 0x5400e987bbc1c920ull,
+    0xed246723473e3813ull, 0x290123e9aab23b68ull,
+    0x9436c0760c86e30bull, 0xf9a0b6720aaf6521ull,
+    0xb94470938fa89bceull, 0xf808e40e8d5b3e69ull,
+    0xe7958cb87392c2c2ull, 0xb60b1d1230b20e04ull,
+    0x90bd77f3483bb9b9ull, 0xb1c6f22b5e6f48c2ull,
+    0xb4ecd5f01a4aa828ull, 0x1e38aeb6360b1af3ull,
+    0xe2280b6c20dd5232ull, 0x25c6da63c38de1b0ull,
+    0x8d590723948a535full, 0x579c487e5a38ad0eull,
+    0xb0af48ec79ace837ull, 0x2d835a9df0c6d851ull,
+    0xdcdb1b2798182244ull, 0xf8e431456cf88e65ull,
+    0x8a08f0f8bf0f156bull, 0x1b8e9ecb641b58ffull,
+    0xac8b2d36eed2dac5ull, 0xe272467e3d222f3full,
+    0xd7adf884aa879177ull, 0x5b0ed81dcc6abb0full,
+    0x86ccbb52ea94baeaull, 0x98e947129fc2b4e9ull,
+    0xa87fea27a539e9a5ull, 0x3f2398d747b36224ull,
+    0xd29fe4b18e88640eull, 0x8eec7f0d19a03aadull,
+    0x83a3eeeef9153e89ull, 0x1953cf68300424acull,
+    0xa48ceaaab75a8e2bull, 0x5fa8c3423c052dd7ull,
+    0xcdb02555653131b6ull, 0x3792f412cb06794dull,
+    0x808e17555f3ebf11ull, 0xe2bbd88bbee40bd0ull,
+    0xa0b19d2ab70e6ed6ull, 0x5b6aceaeae9d0ec4ull,
+    0xc8de047564d20a8bull, 0xf245825a5a445275ull,
+    0xfb158592be068d2eull, 0xeed6e2f0f0d56712ull,
+    0x9ced737bb6c4183dull, 0x55464dd69685606bull,
+    0xc428d05aa4751e4cull, 0xaa97e14c3c26b886ull,
+    0xf53304714d9265dfull, 0xd53dd99f4b3066a8ull,
+    0x993fe2c6d07b7fabull, 0xe546a8038efe4029ull,
+    0xbf8fdb78849a5f96ull, 0xde98520472bdd033ull,
+    0xef73d256a5c0f77cull, 0x963e66858f6d4440ull,
+    0x95a8637627989aadull, 0xdde7001379a44aa8ull,
+    0xbb127c53b17ec159ull, 0x5560c018580d5d52ull,
+    0xe9d71b689dde71afull, 0xaab8f01e6e10b4a6ull,
+    0x9226712162ab070dull, 0xcab3961304ca70e8ull,
+    0xb6b00d69bb55c8d1ull, 0x3d607b97c5fd0d22ull,
+    0xe45c10c42a2b3b05ull, 0x8cb89a7db77c506aull,
+    0x8eb98a7a9a5b04e3ull, 0x77f3608e92adb242ull,
+    0xb267ed1940f1c61cull, 0x55f038b237591ed3ull,
+    0xdf01e85f912e37a3ull, 0x6b6c46dec52f6688ull,
+    0x8b61313bbabce2c6ull, 0x2323ac4b3b3da015ull,
+    0xae397d8aa96c1b77ull, 0xabec975e0a0d081aull,
+    0xd9c7dced53c72255ull, 0x96e7bd358c904a21ull,
+    0x881cea14545c7575ull, 0x7e50d64177da2e54ull,
+    0xaa242499697392d2ull, 0xdde50bd1d5d0b9e9ull,
+    0xd4ad2dbfc3d07787ull, 0x955e4ec64b44e864ull,
+    0x84ec3c97da624ab4ull, 0xbd5af13bef0b113eull,
+    0xa6274bbdd0fadd61ull, 0xecb1ad8aeacdd58eull,
+    0xcfb11ead453994baull, 0x67de18eda5814af2ull,
+    0x81ceb32c4b43fcf4ull, 0x80eacf948770ced7ull,
+    0xa2425ff75e14fc31ull, 0xa1258379a94d028dull,
+    0xcad2f7f5359a3b3eull, 0x096ee45813a04330ull,
+    0xfd87b5f28300ca0dull, 0x8bca9d6e188853fcull,
+    0x9e74d1b791e07e48ull, 0x775ea264cf55347eull,
+    0xc612062576589ddaull, 0x95364afe032a819eull,
+    0xf79687aed3eec551ull, 0x3a83ddbd83f52205ull,
+    0x9abe14cd44753b52ull, 0xc4926a9672793543ull,
+    0xc16d9a0095928a27ull, 0x75b7053c0f178294ull,
+    0xf1c90080baf72cb1ull, 0x5324c68b12dd6339ull,
+    0x971da05074da7beeull, 0xd3f6fc16ebca5e04ull,
+    0xbce5086492111aeaull, 0x88f4bb1ca6bcf585ull,
+    0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e6ull,
+    0x9392ee8e921d5d07ull, 0x3aff322e62439fd0ull,
+    0xb877aa3236a4b449ull, 0x09befeb9fad487c3ull,
+    0xe69594bec44de15bull, 0x4c2ebe687989a9b4ull,
+    0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a11ull,
+    0xb424dc35095cd80full, 0x538484c19ef38c95ull,
+    0xe12e13424bb40e13ull, 0x2865a5f206b06fbaull,
+    0x8cbccc096f5088cbull, 0xf93f87b7442e45d4ull,
+    0xafebff0bcb24aafeull, 0xf78f69a51539d749ull,
+    0xdbe6fecebdedd5beull, 0xb573440e5a884d1cull,
+    0x89705f4136b4a597ull, 0x31680a88f8953031ull,
+    0xabcc77118461cefcull, 0xfdc20d2b36ba7c3eull,
+    0xd6bf94d5e57a42bcull, 0x3d32907604691b4dull,
+    0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b110ull,
+    0xa7c5ac471b478423ull, 0x0fcf80dc33721d54ull,
+    0xd1b71758e219652bull, 0xd3c36113404ea4a9ull,
+    0x83126e978d4fdf3bull, 0x645a1cac083126eaull,
+    0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a4ull,
+    0xccccccccccccccccull, 0xcccccccccccccccdull,
+    0x8000000000000000ull, 0x0000000000000000ull,
+    0xa000000000000000ull, 0x0000000000000000ull,
+    0xc800000000000000ull, 0x0000000000000000ull,
+    0xfa00000000000000ull, 0x0000000000000000ull,
+    0x9c40000000000000ull, 0x0000000000000000ull,
+    0xc350000000000000ull, 0x0000000000000000ull,
+    0xf424000000000000ull, 0x0000000000000000ull,
+    0x9896800000000000ull, 0x0000000000000000ull,
+    0xbebc200000000000ull, 0x0000000000000000ull,
+    0xee6b280000000000ull, 0x0000000000000000ull,
+    0x9502f90000000000ull, 0x0000000000000000ull,
+    0xba43b74000000000ull, 0x0000000000000000ull,
+    0xe8d4a51000000000ull, 0x0000000000000000ull,
+    0x9184e72a00000000ull, 0x0000000000000000ull,
+    0xb5e620f480000000ull, 0x0000000000000000ull,
+    0xe35fa931a0000000ull, 0x0000000000000000ull,
+    0x8e1bc9bf04000000ull, 0x0000000000000000ull,
+    0xb1a2bc2ec5000000ull, 0x0000000000000000ull,
+    0xde0b6b3a76400000ull, 0x0000000000000000ull,
+    0x8ac7230489e80000ull, 0x0000000000000000ull,
+    0xad78ebc5ac620000ull, 0x0000000000000000ull,
+    0xd8d726b7177a8000ull, 0x0000000000000000ull,
+    0x878678326eac9000ull, 0x0000000000000000ull,
+    0xa968163f0a57b400ull, 0x0000000000000000ull,
+    0xd3c21bcecceda100ull, 0x0000000000000000ull,
+    0x84595161401484a0ull, 0x0000000000000000ull,
+    0xa56fa5b99019a5c8ull, 0x0000000000000000ull,
+    0xcecb8f27f4200f3aull, 0x0000000000000000ull,
+    0x813f3978f8940984ull, 0x4000000000000000ull,
+    0xa18f07d736b90be5ull, 0x5000000000000000ull,
+    0xc9f2c9cd04674edeull, 0xa400000000000000ull,
+    0xfc6f7c4045812296ull, 0x4d00000000000000ull,
+    0x9dc5ada82b70b59dull, 0xf020000000000000ull,
+    0xc5371912364ce305ull, 0x6c28000000000000ull,
+    0xf684df56c3e01bc6ull, 0xc732000000000000ull,
+    0x9a130b963a6c115cull, 0x3c7f400000000000ull,
+    0xc097ce7bc90715b3ull, 0x4b9f100000000000ull,
+    0xf0bdc21abb48db20ull, 0x1e86d40000000000ull,
+    0x96769950b50d88f4ull, 0x1314448000000000ull,
+    0xbc143fa4e250eb31ull, 0x17d955a000000000ull,
+    0xeb194f8e1ae525fdull, 0x5dcfab0800000000ull,
+    0x92efd1b8d0cf37beull, 0x5aa1cae500000000ull,
+    0xb7abc627050305adull, 0xf14a3d9e40000000ull,
+    0xe596b7b0c643c719ull, 0x6d9ccd05d0000000ull,
+    0x8f7e32ce7bea5c6full, 0xe4820023a2000000ull,
+    0xb35dbf821ae4f38bull, 0xdda2802c8a800000ull,
+    0xe0352f62a19e306eull, 0xd50b2037ad200000ull,
+    0x8c213d9da502de45ull, 0x4526f422cc340000ull,
+    0xaf298d050e4395d6ull, 0x9670b12b7f410000ull,
+    0xdaf3f04651d47b4cull, 0x3c0cdd765f114000ull,
+    0x88d8762bf324cd0full, 0xa5880a69fb6ac800ull,
+    0xab0e93b6efee0053ull, 0x8eea0d047a457a00ull,
+    0xd5d238a4abe98068ull, 0x72a4904598d6d880ull,
+    0x85a36366eb71f041ull, 0x47a6da2b7f864750ull,
+    0xa70c3c40a64e6c51ull, 0x999090b65f67d924ull,
+    0xd0cf4b50cfe20765ull, 0xfff4b4e3f741cf6dull,
+    0x82818f1281ed449full, 0xbff8f10e7a8921a4ull,
+    0xa321f2d7226895c7ull, 0xaff72d52192b6a0dull,
+    0xcbea6f8ceb02bb39ull, 0x9bf4f8a69f764490ull,
+    0xfee50b7025c36a08ull, 0x02f236d04753d5b4ull,
+    0x9f4f2726179a2245ull, 0x01d762422c946590ull,
+    0xc722f0ef9d80aad6ull, 0x424d3ad2b7b97ef5ull,
+    0xf8ebad2b84e0d58bull, 0xd2e0898765a7deb2ull,
+    0x9b934c3b330c8577ull, 0x63cc55f49f88eb2full,
+    0xc2781f49ffcfa6d5ull, 0x3cbf6b71c76b25fbull,
+    0xf316271c7fc3908aull, 0x8bef464e3945ef7aull,
+    0x97edd871cfda3a56ull, 0x97758bf0e3cbb5acull,
+    0xbde94e8e43d0c8ecull, 0x3d52eeed1cbea317ull,
+    0xed63a231d4c4fb27ull, 0x4ca7aaa863ee4bddull,
+    0x945e455f24fb1cf8ull, 0x8fe8caa93e74ef6aull,
+    0xb975d6b6ee39e436ull, 0xb3e2fd538e122b44ull,
+    0xe7d34c64a9c85d44ull, 0x60dbbca87196b616ull,
+    0x90e40fbeea1d3a4aull, 0xbc8955e946fe31cdull,
+    0xb51d13aea4a488ddull, 0x6babab6398bdbe41ull,
+    0xe264589a4dcdab14ull, 0xc696963c7eed2dd1ull,
+    0x8d7eb76070a08aecull, 0xfc1e1de5cf543ca2ull,
+    0xb0de65388cc8ada8ull, 0x3b25a55f43294bcbull,
+    0xdd15fe86affad912ull, 0x49ef0eb713f39ebeull,
+    0x8a2dbf142dfcc7abull, 0x6e3569326c784337ull,
+    0xacb92ed9397bf996ull, 0x49c2c37f07965404ull,
+    0xd7e77a8f87daf7fbull, 0xdc33745ec97be906ull,
+    0x86f0ac99b4e8dafdull, 0x69a028bb3ded71a3ull,
+    0xa8acd7c0222311bcull, 0xc40832ea0d68ce0cull,
+    0xd2d80db02aabd62bull, 0xf50a3fa490c30190ull,
+    0x83c7088e1aab65dbull, 0x792667c6da79e0faull,
+    0xa4b8cab1a1563f52ull, 0x577001b891185938ull,
+    0xcde6fd5e09abcf26ull, 0xed4c0226b55e6f86ull,
+    0x80b05e5ac60b6178ull, 0x544f8158315b05b4ull,
+    0xa0dc75f1778e39d6ull, 0x696361ae3db1c721ull,
+    0xc913936dd571c84cull, 0x03bc3a19cd1e38e9ull,
+    0xfb5878494ace3a5full, 0x04ab48a04065c723ull,
+    0x9d174b2dcec0e47bull, 0x62eb0d64283f9c76ull,
+    0xc45d1df942711d9aull, 0x3ba5d0bd324f8394ull,
+    0xf5746577930d6500ull, 0xca8f44ec7ee36479ull,
+    0x9968bf6abbe85f20ull, 0x7e998b13cf4e1ecbull,
+    0xbfc2ef456ae276e8ull, 0x9e3fedd8c321a67eull,
+    0xefb3ab16c59b14a2ull, 0xc5cfe94ef3ea101eull,
+    0x95d04aee3b80ece5ull, 0xbba1f1d158724a12ull,
+    0xbb445da9ca61281full, 0x2a8a6e45ae8edc97ull,
+    0xea1575143cf97226ull, 0xf52d09d71a3293bdull,
+    0x924d692ca61be758ull, 0x593c2626705f9c56ull,
+    0xb6e0c377cfa2e12eull, 0x6f8b2fb00c77836cull,
+    0xe498f455c38b997aull, 0x0b6dfb9c0f956447ull,
+    0x8edf98b59a373fecull, 0x4724bd4189bd5eacull,
+    0xb2977ee300c50fe7ull, 0x58edec91ec2cb657ull,
+    0xdf3d5e9bc0f653e1ull, 0x2f2967b66737e3edull,
+    0x8b865b215899f46cull, 0xbd79e0d20082ee74ull,
+    0xae67f1e9aec07187ull, 0xecd8590680a3aa11ull,
+    0xda01ee641a708de9ull, 0xe80e6f4820cc9495ull,
+    0x884134fe908658b2ull, 0x3109058d147fdcddull,
+    0xaa51823e34a7eedeull, 0xbd4b46f0599fd415ull,
+    0xd4e5e2cdc1d1ea96ull, 0x6c9e18ac7007c91aull,
+    0x850fadc09923329eull, 0x03e2cf6bc604ddb0ull,
+    0xa6539930bf6bff45ull, 0x84db8346b786151cull,
+    0xcfe87f7cef46ff16ull, 0xe612641865679a63ull,
+    0x81f14fae158c5f6eull, 0x4fcb7e8f3f60c07eull,
+    0xa26da3999aef7749ull, 0xe3be5e330f38f09dull,
+    0xcb090c8001ab551cull, 0x5cadf5bfd3072cc5ull,
+    0xfdcb4fa002162a63ull, 0x73d9732fc7c8f7f6ull,
+    0x9e9f11c4014dda7eull, 0x2867e7fddcdd9afaull,
+    0xc646d63501a1511dull, 0xb281e1fd541501b8ull,
+    0xf7d88bc24209a565ull, 0x1f225a7ca91a4226ull,
+    0x9ae757596946075full, 0x3375788de9b06958ull,
+    0xc1a12d2fc3978937ull, 0x0052d6b1641c83aeull,
+    0xf209787bb47d6b84ull, 0xc0678c5dbd23a49aull,
+    0x9745eb4d50ce6332ull, 0xf840b7ba963646e0ull,
+    0xbd176620a501fbffull, 0xb650e5a93bc3d898ull,
+    0xec5d3fa8ce427affull, 0xa3e51f138ab4cebeull,
+    0x93ba47c980e98cdfull, 0xc66f336c36b10137ull,
+    0xb8a8d9bbe123f017ull, 0xb80b0047445d4184ull,
+    0xe6d3102ad96cec1dull, 0xa60dc059157491e5ull,
+    0x9043ea1ac7e41392ull, 0x87c89837ad68db2full,
+    0xb454e4a179dd1877ull, 0x29babe4598c311fbull,
+    0xe16a1dc9d8545e94ull, 0xf4296dd6fef3d67aull,
+    0x8ce2529e2734bb1dull, 0x1899e4a65f58660cull,
+    0xb01ae745b101e9e4ull, 0x5ec05dcff72e7f8full,
+    0xdc21a1171d42645dull, 0x76707543f4fa1f73ull,
+    0x899504ae72497ebaull, 0x6a06494a791c53a8ull,
+    0xabfa45da0edbde69ull, 0x0487db9d17636892ull,
+    0xd6f8d7509292d603ull, 0x45a9d2845d3c42b6ull,
+    0x865b86925b9bc5c2ull, 0x0b8a2392ba45a9b2ull,
+    0xa7f26836f282b732ull, 0x8e6cac7768d7141eull,
+    0xd1ef0244af2364ffull, 0x3207d795430cd926ull,
+    0x8335616aed761f1full, 0x7f44e6bd49e807b8ull,
+    0xa402b9c5a8d3a6e7ull, 0x5f16206c9c6209a6ull,
+    0xcd036837130890a1ull, 0x36dba887c37a8c0full,
+    0x802221226be55a64ull, 0xc2494954da2c9789ull,
+    0xa02aa96b06deb0fdull, 0xf2db9baa10b7bd6cull,
+    0xc83553c5c8965d3dull, 0x6f92829494e5acc7ull,
+    0xfa42a8b73abbf48cull, 0xcb772339ba1f17f9ull,
+    0x9c69a97284b578d7ull, 0xff2a760414536efbull,
+    0xc38413cf25e2d70dull, 0xfef5138519684abaull,
+    0xf46518c2ef5b8cd1ull, 0x7eb258665fc25d69ull,
+    0x98bf2f79d5993802ull, 0xef2f773ffbd97a61ull,
+    0xbeeefb584aff8603ull, 0xaafb550ffacfd8faull,
+    0xeeaaba2e5dbf6784ull, 0x95ba2a53f983cf38ull,
+    0x952ab45cfa97a0b2ull, 0xdd945a747bf26183ull,
+    0xba756174393d88dfull, 0x94f971119aeef9e4ull,
+    0xe912b9d1478ceb17ull, 0x7a37cd5601aab85dull,
+    0x91abb422ccb812eeull, 0xac62e055c10ab33aull,
+    0xb616a12b7fe617aaull, 0x577b986b314d6009ull,
+    0xe39c49765fdf9d94ull, 0xed5a7e85fda0b80bull,
+    0x8e41ade9fbebc27dull, 0x14588f13be847307ull,
+    0xb1d219647ae6b31cull, 0x596eb2d8ae258fc8ull,
+    0xde469fbd99a05fe3ull, 0x6fca5f8ed9aef3bbull,
+    0x8aec23d680043beeull, 0x25de7bb9480d5854ull,
+    0xada72ccc20054ae9ull, 0xaf561aa79a10ae6aull,
+    0xd910f7ff28069da4ull, 0x1b2ba1518094da04ull,
+    0x87aa9aff79042286ull, 0x90fb44d2f05d0842ull,
+    0xa99541bf57452b28ull, 0x353a1607ac744a53ull,
+    0xd3fa922f2d1675f2ull, 0x42889b8997915ce8ull,
+    0x847c9b5d7c2e09b7ull, 0x69956135febada11ull,
+    0xa59bc234db398c25ull, 0x43fab9837e699095ull,
+    0xcf02b2c21207ef2eull, 0x94f967e45e03f4bbull,
+    0x8161afb94b44f57dull, 0x1d1be0eebac278f5ull,
+    0xa1ba1ba79e1632dcull, 0x6462d92a69731732ull,
+    0xca28a291859bbf93ull, 0x7d7b8f7503cfdcfeull,
+    0xfcb2cb35e702af78ull, 0x5cda735244c3d43eull,
+    0x9defbf01b061adabull, 0x3a0888136afa64a7ull,
+    0xc56baec21c7a1916ull, 0x088aaa1845b8fdd0ull,
+    0xf6c69a72a3989f5bull, 0x8aad549e57273d45ull,
+    0x9a3c2087a63f6399ull, 0x36ac54e2f678864bull,
+    0xc0cb28a98fcf3c7full, 0x84576a1bb416a7ddull,
+    0xf0fdf2d3f3c30b9full, 0x656d44a2a11c51d5ull,
+    0x969eb7c47859e743ull, 0x9f644ae5a4b1b325ull,
+    0xbc4665b596706114ull, 0x873d5d9f0dde1feeull,
+    0xeb57ff22fc0c7959ull, 0xa90cb506d155a7eaull,
+    0x9316ff75dd87cbd8ull, 0x09a7f12442d588f2ull,
+    0xb7dcbf5354e9beceull, 0x0c11ed6d538aeb2full,
+    0xe5d3ef282a242e81ull, 0x8f1668c8a86da5faull,
+    0x8fa475791a569d10ull, 0xf96e017d694487bcull,
+    0xb38d92d760ec4455ull, 0x37c981dcc395a9acull,
+    0xe070f78d3927556aull, 0x85bbe253f47b1417ull,
+    0x8c469ab843b89562ull, 0x93956d7478ccec8eull,
+    0xaf58416654a6babbull, 0x387ac8d1970027b2ull,
+    0xdb2e51bfe9d0696aull, 0x06997b05fcc0319eull,
+    0x88fcf317f22241e2ull, 0x441fece3bdf81f03ull,
+    0xab3c2fddeeaad25aull, 0xd527e81cad7626c3ull,
+    0xd60b3bd56a5586f1ull, 0x8a71e223d8d3b074ull,
+    0x85c7056562757456ull, 0xf6872d5667844e49ull,
+    0xa738c6bebb12d16cull, 0xb428f8ac016561dbull,
+    0xd106f86e69d785c7ull, 0xe13336d701beba52ull,
+    0x82a45b450226b39cull, 0xecc0024661173473ull,
+    0xa34d721642b06084ull, 0x27f002d7f95d0190ull,
+    0xcc20ce9bd35c78a5ull, 0x31ec038df7b441f4ull,
+    0xff290242c83396ceull, 0x7e67047175a15271ull,
+    0x9f79a169bd203e41ull, 0x0f0062c6e984d386ull,
+    0xc75809c42c684dd1ull, 0x52c07b78a3e60868ull,
+    0xf92e0c3537826145ull, 0xa7709a56ccdf8a82ull,
+    0x9bbcc7a142b17ccbull, 0x88a66076400bb691ull,
+    0xc2abf989935ddbfeull, 0x6acff893d00ea435ull,
+    0xf356f7ebf83552feull, 0x0583f6b8c4124d43ull,
+    0x98165af37b2153deull, 0xc3727a337a8b704aull,
+    0xbe1bf1b059e9a8d6ull, 0x744f18c0592e4c5cull,
+    0xeda2ee1c7064130cull, 0x1162def06f79df73ull,
+    0x9485d4d1c63e8be7ull, 0x8addcb5645ac2ba8ull,
+    0xb9a74a0637ce2ee1ull, 0x6d953e2bd7173692ull,
+    0xe8111c87c5c1ba99ull, 0xc8fa8db6ccdd0437ull,
+    0x910ab1d4db9914a0ull, 0x1d9c9892400a22a2ull,
+    0xb54d5e4a127f59c8ull, 0x2503beb6d00cab4bull,
+    0xe2a0b5dc971f303aull, 0x2e44ae64840fd61dull,
+    0x8da471a9de737e24ull, 0x5ceaecfed289e5d2ull,
+    0xb10d8e1456105dadull, 0x7425a83e872c5f47ull,
+    0xdd50f1996b947518ull, 0xd12f124e28f77719ull,
+    0x8a5296ffe33cc92full, 0x82bd6b70d99aaa6full,
+    0xace73cbfdc0bfb7bull, 0x636cc64d1001550bull,
+    0xd8210befd30efa5aull, 0x3c47f7e05401aa4eull,
+    0x8714a775e3e95c78ull, 0x65acfaec34810a71ull,
+    0xa8d9d1535ce3b396ull, 0x7f1839a741a14d0dull,
+    0xd31045a8341ca07cull, 0x1ede48111209a050ull,
+    0x83ea2b892091e44dull, 0x934aed0aab460432ull,
+    0xa4e4b66b68b65d60ull, 0xf81da84d5617853full,
+    0xce1de40642e3f4b9ull, 0x36251260ab9d668eull,
+    0x80d2ae83e9ce78f3ull, 0xc1d72b7c6b426019ull,
+    0xa1075a24e4421730ull, 0xb24cf65b8612f81full,
+    0xc94930ae1d529cfcull, 0xdee033f26797b627ull,
+    0xfb9b7cd9a4a7443cull, 0x169840ef017da3b1ull,
+    0x9d412e0806e88aa5ull, 0x8e1f289560ee864eull,
+    0xc491798a08a2ad4eull, 0xf1a6f2bab92a27e2ull,
+    0xf5b5d7ec8acb58a2ull, 0xae10af696774b1dbull,
+    0x9991a6f3d6bf1765ull, 0xacca6da1e0a8ef29ull,
+    0xbff610b0cc6edd3full, 0x17fd090a58d32af3ull,
+    0xeff394dcff8a948eull, 0xddfc4b4cef07f5b0ull,
+    0x95f83d0a1fb69cd9ull, 0x4abdaf101564f98eull,
+    0xbb764c4ca7a4440full, 0x9d6d1ad41abe37f1ull,
+    0xea53df5fd18d5513ull, 0x84c86189216dc5edull,
+    0x92746b9be2f8552cull, 0x32fd3cf5b4e49bb4ull,
+    0xb7118682dbb66a77ull, 0x3fbc8c33221dc2a1ull,
+    0xe4d5e82392a40515ull, 0x0fabaf3feaa5334aull,
+    0x8f05b1163ba6832dull, 0x29cb4d87f2a7400eull,
+    0xb2c71d5bca9023f8ull, 0x743e20e9ef511012ull,
+    0xdf78e4b2bd342cf6ull, 0x914da9246b255416ull,
+    0x8bab8eefb6409c1aull, 0x1ad089b6c2f7548eull,
+    0xae9672aba3d0c320ull, 0xa184ac2473b529b1ull,
+    0xda3c0f568cc4f3e8ull, 0xc9e5d72d90a2741eull,
+    0x8865899617fb1871ull, 0x7e2fa67c7a658892ull,
+    0xaa7eebfb9df9de8dull, 0xddbb901b98feeab7ull,
+    0xd51ea6fa85785631ull, 0x552a74227f3ea565ull,
+    0x8533285c936b35deull, 0xd53a88958f87275full,
+    0xa67ff273b8460356ull, 0x8a892abaf368f137ull,
+    0xd01fef10a657842cull, 0x2d2b7569b0432d85ull,
+    0x8213f56a67f6b29bull, 0x9c3b29620e29fc73ull,
+    0xa298f2c501f45f42ull, 0x8349f3ba91b47b8full,
+    0xcb3f2f7642717713ull, 0x241c70a936219a73ull,
+    0xfe0efb53d30dd4d7ull, 0xed238cd383aa0110ull,
+    0x9ec95d1463e8a506ull, 0xf4363804324a40aaull,
+    0xc67bb4597ce2ce48ull, 0xb143c6053edcd0d5ull,
+    0xf81aa16fdc1b81daull, 0xdd94b7868e94050aull,
+    0x9b10a4e5e9913128ull, 0xca7cf2b4191c8326ull,
+    0xc1d4ce1f63f57d72ull, 0xfd1c2f611f63a3f0ull,
+    0xf24a01a73cf2dccfull, 0xbc633b39673c8cecull,
+    0x976e41088617ca01ull, 0xd5be0503e085d813ull,
+    0xbd49d14aa79dbc82ull, 0x4b2d8644d8a74e18ull,
+    0xec9c459d51852ba2ull, 0xddf8e7d60ed1219eull,
+    0x93e1ab8252f33b45ull, 0xcabb90e5c942b503ull,
+    0xb8da1662e7b00a17ull, 0x3d6a751f3b936243ull,
+    0xe7109bfba19c0c9dull, 0x0cc512670a783ad4ull,
+    0x906a617d450187e2ull, 0x27fb2b80668b24c5ull,
+    0xb484f9dc9641e9daull, 0xb1f9f660802dedf6ull,
+    0xe1a63853bbd26451ull, 0x5e7873f8a0396973ull,
+    0x8d07e33455637eb2ull, 0xdb0b487b6423e1e8ull,
+    0xb049dc016abc5e5full, 0x91ce1a9a3d2cda62ull,
+    0xdc5c5301c56b75f7ull, 0x7641a140cc7810fbull,
+    0x89b9b3e11b6329baull, 0xa9e904c87fcb0a9dull,
+    0xac2820d9623bf429ull, 0x546345fa9fbdcd44ull,
+    0xd732290fbacaf133ull, 0xa97c177947ad4095ull,
+    0x867f59a9d4bed6c0ull, 0x49ed8eabcccc485dull,
+    0xa81f301449ee8c70ull, 0x5c68f256bfff5a74ull,
+    0xd226fc195c6a2f8cull, 0x73832eec6fff3111ull,
+    0x83585d8fd9c25db7ull, 0xc831fd53c5ff7eabull,
+    0xa42e74f3d032f525ull, 0xba3e7ca8b77f5e55ull,
+    0xcd3a1230c43fb26full, 0x28ce1bd2e55f35ebull,
+    0x80444b5e7aa7cf85ull, 0x7980d163cf5b81b3ull,
+    0xa0555e361951c366ull, 0xd7e105bcc332621full,
+    0xc86ab5c39fa63440ull, 0x8dd9472bf3fefaa7ull,
+    0xfa856334878fc150ull, 0xb14f98f6f0feb951ull,
+    0x9c935e00d4b9d8d2ull, 0x6ed1bf9a569f33d3ull,
+    0xc3b8358109e84f07ull, 0x0a862f80ec4700c8ull,
+    0xf4a642e14c6262c8ull, 0xcd27bb612758c0faull,
+    0x98e7e9cccfbd7dbdull, 0x8038d51cb897789cull,
+    0xbf21e44003acdd2cull, 0xe0470a63e6bd56c3ull,
+    0xeeea5d5004981478ull, 0x1858ccfce06cac74ull,
+    0x95527a5202df0ccbull, 0x0f37801e0c43ebc8ull,
+    0xbaa718e68396cffdull, 0xd30560258f54e6baull,
+    0xe950df20247c83fdull, 0x47c6b82ef32a2069ull,
+    0x91d28b7416cdd27eull, 0x4cdc331d57fa5441ull,
+    0xb6472e511c81471dull, 0xe0133fe4adf8e952ull,
+    0xe3d8f9e563a198e5ull, 0x58180fddd97723a6ull,
+    0x8e679c2f5e44ff8full, 0x570f09eaa7ea7648ull,
+};
+
+struct FloatFormat {
+    i32 mantissa_explicit_bits;
+    i32 minimum_exponent;
+    i32 infinite_power;
+    i32 min_exponent_round_to_even;
+    i32 max_exponent_round_to_even;
+    i32 max_exponent_fast_path;
+};
+
+static constexpr FloatFormat f64_format = { 52, -1023, 0x7FF, -4,  23, 22 };
+static constexpr FloatFormat f32_format = { 23, -127,  0xFF,  -17, 10, 10 };
+
+#define SMALLEST_POWER_OF_TEN -342
+#define LARGEST_POWER_OF_TEN  308
+
+struct AdjustedMantissa {
+    u64 mantissa;
+    i32 power2; // Biased exponent.
+};
+
+static AdjustedMantissa eisel_lemire(const FloatFormat &format, i64 q, u64 w) {
+    AdjustedMantissa answer = {};
+
+    if (w == 0 || q < SMALLEST_POWER_OF_TEN) return answer;
+    if (q > LARGEST_POWER_OF_TEN) {
+        answer.power2 = format.infinite_power;
+        return answer;
+    }
+
+    i32 lz = __builtin_clzll(w);
+    w    <<= lz;
+
+    // w * 5^q, with a second multiplication against the low half of the table entry only when the bits that decide
+    // rounding are all ones in the first.
+    usize index         = 2 * (q - SMALLEST_POWER_OF_TEN);
+    u64 precision_mask  = 0xFFFFFFFFFFFFFFFFull >> (format.mantissa_explicit_bits + 3);
+    unsigned __int128 p = (unsigned __int128) w * power_of_five_128[index];
+    u64 high            = (u64) (p >> 64);
+    u64 low             = (u64) p;
+
+    if ((high & precision_mask) == precision_mask) {
+        unsigned __int128 p2 = (unsigned __int128) w * power_of_five_128[index + 1];
+        u64 p2_high          = (u64) (p2 >> 64);
+        low                 += p2_high;
+        if (p2_high > low) ++high;
+    }
+
+    i32 upperbit    = (i32) (high >> 63);
+    i32 shift       = upperbit + 64 - format.mantissa_explicit_bits - 3;
+    answer.mantissa = high >> shift;
+    // floor(log2(10^q)) + 63, exact over the table's range.
+    answer.power2   = (i32) ((((152170 + 65536) * q) >> 16) + 63) + upperbit - lz - format.minimum_exponent;
+
+    if (answer.power2 <= 0) {
+        // Subnormal.
+        if (-answer.power2 + 1 >= 64) {
+            answer.mantissa = 0;
+            answer.power2   = 0;
+            return answer;
+        }
+
+        answer.mantissa >>= -answer.power2 + 1;
+        answer.mantissa  += answer.mantissa & 1;
+        answer.mantissa >>= 1;
+        answer.power2     = answer.mantissa < (1ull << format.mantissa_explicit_bits) ? 0 : 1;
+        return answer;
+    }
+
+    // Exactly halfway between two floats: round to even.
+    if (low <= 1 && q >= format.min_exponent_round_to_even && q <= format.max_exponent_round_to_even && (answer.mantissa & 3) == 1) {
+        if ((answer.mantissa << shift) == high) answer.mantissa &= ~1ull;
+    }
+
+    answer.mantissa += answer.mantissa & 1;
+    answer.mantissa >>= 1;
+
+    if (answer.mantissa >= (2ull << format.mantissa_explicit_bits)) {
+        answer.mantissa = 1ull << format.mantissa_explicit_bits;
+        answer.power2++;
+    }
+
+    answer.mantissa &= ~(1ull << format.mantissa_explicit_bits);
+
+    if (answer.power2 >= format.infinite_power) {
+        answer.power2   = format.infinite_power;
+        answer.mantissa = 0;
+    }
+
+    return answer;
+}
+
+struct ParsedDecimal {
+    u64 mantissa;
+    i64 exponent;
+    bool negative;
+    bool truncated; // More than 19 significant digits; mantissa holds the first 19.
+    bool inf;
+    bool nan;
+    usize length;
+};
+
+static inline bool match_insensitive(const char *data, usize length, const char *word) {
+    usize word_length = std::strlen(word);
+    if (length < word_length) return false;
+
+    for (usize i = 0; i < word_length; ++i) {
+        if ((data[i] | 0x20) != word[i]) return false;
+    }
+
+    return true;
+}
+
+// [+-] digits [. digits] [(e|E) [+-] digits], or inf/infinity/nan. length == 0 on failure.
+static ParsedDecimal parse_decimal(const char *data, usize length) {
+    ParsedDecimal d = {};
+    usize i = 0;
+
+    if (i < length && (data[i] == '-' || data[i] == '+')) {
+        d.negative = data[i] == '-';
+        ++i;
+    }
+
+    if (i < length && !is_digit(data[i]) && data[i] != '.') {
+        if (match_insensitive(data + i, length - i, "infinity")) { d.inf = true; d.length = i + 8; }
+        else if (match_insensitive(data + i, length - i, "inf"))  { d.inf = true; d.length = i + 3; }
+        else if (match_insensitive(data + i, length - i, "nan"))  { d.nan = true; d.length = i + 3; }
+        return d;
+    }
+
+    // Leading zeros are not significant.
+    usize digits_start = i;
+    while (i < length && data[i] == '0') ++i;
+    bool any_digits = i > digits_start;
+
+    usize integer_start = i;
+    usize consumed      = accumulate_digits(data + i, length - i, &d.mantissa, 19);
+    i += consumed;
+    usize significant = consumed;
+
+    // Digits past the 19th only scale the value.
+    while (i < length && is_digit(data[i])) {
+        if (data[i] != '0') d.truncated = true;
+        ++d.exponent;
+        ++i;
+    }
+
+    any_digits |= i > integer_start;
+
+    if (i < length && data[i] == '.') {
+        ++i;
+        usize fraction_start = i;
+
+        if (significant == 0) {
+            // Still in leading zeros, e.g. 0.000123.
+            while (i < length && data[i] == '0') ++i;
+            d.exponent -= i - fraction_start;
+        }
+
+        usize fraction_digits = accumulate_digits(data + i, length - i, &d.mantissa, 19 - significant);
+        i           += fraction_digits;
+        d.exponent  -= fraction_digits;
+        significant += fraction_digits;
+
+        while (i < length && is_digit(data[i])) {
+            if (data[i] != '0') d.truncated = true;
+            ++i;
+        }
+
+        any_digits |= i > fraction_start;
+    }
+
+    if (!any_digits) return d;
+
+    if (i < length && (data[i] == 'e' || data[i] == 'E')) {
+        usize exponent_start = i++;
+        bool exponent_negative = false;
+
+        if (i < length && (data[i] == '-' || data[i] == '+')) {
+            exponent_negative = data[i] == '-';
+            ++i;
+        }
+
+        if (i < length && is_digit(data[i])) {
+            i64 e = 0;
+            for (; i < length && is_digit(data[i]); ++i) {
+                // Anything this large is already 0 or inf, so stop growing and avoid overflow.
+                if (e < 100000) e = e * 10 + (data[i] - '0');
+            }
+
+            d.exponent += exponent_negative ? -e : e;
+        } else {
+            // Not an exponent after all, e.g. "1e" or "2e+". The number ends before the 'e'.
+            i = exponent_start;
+        }
+    }
+
+    d.length = i;
+    return d;
+}
+
+template<typename T>
+static T assemble_float(const FloatFormat &format, AdjustedMantissa am, bool negative) {
+    u64 bits = am.mantissa | ((u64) am.power2 << format.mantissa_explicit_bits);
+    if (negative) bits |= 1ull << (sizeof(T) * 8 - 1);
+
+    T ret;
+    if constexpr (sizeof(T) == sizeof(u32)) {
+        u32 narrow = (u32) bits;
+        std::memcpy(&ret, &narrow, sizeof(T));
+    } else {
+        std::memcpy(&ret, &bits, sizeof(T));
+    }
+
+    return ret;
+}
+
+// Slow path for the rare inputs the fast paths cannot decide: more than 19 significant digits that land too close to
+// a rounding boundary. The digits go into a big decimal that is shifted by powers of two until it sits in [1/2, 1),
+// then the mantissa is read off and rounded. This is the "simple decimal conversion" from wuffs and fast_float. It is
+// exact up to DECIMAL_MAX_DIGITS digits, and past that the dropped digits only matter as a tie breaker, which the
+// truncated flag covers. Nothing here depends on the C locale.
+#define DECIMAL_MAX_DIGITS        768
+#define DECIMAL_POINT_RANGE       2047
+#define DECIMAL_MAX_SHIFT         60
+
+struct Decimal {
+    u32 num_digits;
+    i32 decimal_point; // The value is 0.digits * 10^decimal_point.
+    bool truncated;
+    u8 digits[DECIMAL_MAX_DIGITS];
+};
+
+static void decimal_trim(Decimal *d) {
+    while (d->num_digits > 0 && d->digits[d->num_digits - 1] == 0) --d->num_digits;
+}
+
+// Digits, fraction and exponent of a number parse_decimal() has already validated as length bytes long.
+static void parse_big_decimal(const char *data, usize length, Decimal *d) {
+    d->num_digits    = 0;
+    d->decimal_point = 0;
+    d->truncated     = false;
+
+    usize i = 0;
+    if (data[i] == '-' || data[i] == '+') ++i;
+    while (i < length && data[i] == '0') ++i;
+
+    u32 total_digits = 0;
+    for (; i < length && is_digit(data[i]); ++i, ++total_digits) {
+        if (total_digits < DECIMAL_MAX_DIGITS) d->digits[total_digits] = data[i] - '0';
+        else if (data[i] != '0')               d->truncated = true;
+    }
+
+    if (i < length && data[i] == '.') {
+        usize fraction_start = ++i;
+
+        // Leading zeros of a number below 1 only move the decimal point.
+        if (total_digits == 0) {
+            while (i < length && data[i] == '0') ++i;
+        }
+
+        for (; i < length && is_digit(data[i]); ++i, ++total_digits) {
+            if (total_digits < DECIMAL_MAX_DIGITS) d->digits[total_digits] = data[i] - '0';
+            else if (data[i] != '0')               d->truncated = true;
+        }
+
+        d->decimal_point = -(i32) (i - fraction_start);
+    }
+
+    d->decimal_point += total_digits;
+    d->num_digits     = MIN(total_digits, (u32) DECIMAL_MAX_DIGITS);
+
+    if (i < length && (data[i] == 'e' || data[i] == 'E')) {
+        ++i;
+        bool negative = false;
+        if (data[i] == '-' || data[i] == '+') negative = data[i++] == '-';
+
+        i32 e = 0;
+        for (; i < length; ++i) {
+            if (e < 100000) e = e * 10 + (data[i] - '0');
+        }
+
+        d->decimal_point += negative ? -e : e;
+    }
+
+    decimal_trim(d);
+}
+
+// Multiply by 2^shift, shift <= DECIMAL_MAX_SHIFT. Digits are produced from the least significant end, and the carry
+// never exceeds 9 * 2^60 + carry / 10, so it fits in 64 bits.
+static void decimal_left_shift(Decimal *d, u32 shift) {
+    if (d->num_digits == 0) return;
+
+    u8 out[DECIMAL_MAX_DIGITS + 20];
+    i32 write = sizeof(out) - 1;
+    u64 n     = 0;
+
+    for (i32 read = d->num_digits - 1; read >= 0; --read) {
+        n           += (u64) d->digits[read] << shift;
+        out[write--] = n % 10;
+        n           /= 10;
+    }
+
+    while (n > 0) {
+        out[write--] = n % 10;
+        n           /= 10;
+    }
+
+    u32 count         = sizeof(out) - 1 - write;
+    d->decimal_point += count - d->num_digits;
+    d->num_digits     = MIN(count, (u32) DECIMAL_MAX_DIGITS);
+
+    for (u32 i = d->num_digits; i < count; ++i) {
+        if (out[write + 1 + i] != 0) d->truncated = true;
+    }
+
+    std::memcpy(d->digits, out + write + 1, d->num_digits);
+    decimal_trim(d);
+}
+
+// Divide by 2^shift, shift <= DECIMAL_MAX_SHIFT.
+static void decimal_right_shift(Decimal *d, u32 shift) {
+    u32 read  = 0;
+    u32 write = 0;
+    u64 n     = 0;
+
+    // Pull in digits until there is something to shift out.
+    while ((n >> shift) == 0) {
+        if (read < d->num_digits) {
+            n = 10 * n + d->digits[read++];
+        } else if (n == 0) {
+            return;
+        } else {
+            while ((n >> shift) == 0) {
+                n *= 10;
+                ++read;
+            }
+            break;
+        }
+    }
+
+    d->decimal_point -= (i32) read - 1;
+    if (d->decimal_point < -DECIMAL_POINT_RANGE) {
+        d->num_digits    = 0;
+        d->decimal_point = 0;
+        d->truncated     = false;
+        return;
+    }
+
+    u64 mask = (1ull << shift) - 1;
+    while (read < d->num_digits) {
+        u8 digit          = (u8) (n >> shift);
+        n                 = 10 * (n & mask) + d->digits[read++];
+        d->digits[write++] = digit;
+    }
+
+    while (n > 0) {
+        u8 digit = (u8) (n >> shift);
+        n        = 10 * (n & mask);
+        if (write < DECIMAL_MAX_DIGITS) d->digits[write++] = digit;
+        else if (digit > 0)             d->truncated = true;
+    }
+
+    d->num_digits = write;
+    decimal_trim(d);
+}
+
+// The integer part, rounded half to even. Digits dropped by truncation break ties upwards.
+static u64 decimal_round(const Decimal *d) {
+    if (d->num_digits == 0 || d->decimal_point < 0) return 0;
+    if (d->decimal_point > 18) return UINT64_MAX;
+
+    u32 point = d->decimal_point;
+    u64 n     = 0;
+    for (u32 i = 0; i < point; ++i) n = 10 * n + (i < d->num_digits ? d->digits[i] : 0);
+
+    bool round_up = false;
+    if (point < d->num_digits) {
+        round_up = d->digits[point] >= 5;
+        if (d->digits[point] == 5 && point + 1 == d->num_digits) round_up = d->truncated || (point > 0 && (d->digits[point - 1] & 1));
+    }
+
+    return round_up ? n + 1 : n;
+}
+
+static AdjustedMantissa decimal_to_binary(const FloatFormat &format, Decimal *d) {
+    // Shifting by these powers of two moves the decimal point by exactly n places (2^decimal_shifts[n] < 10^n).
+    static const u8 decimal_shifts[] = { 0, 3, 6, 9, 13, 16, 19, 23, 26, 29, 33, 36, 39, 43, 46, 49, 53, 56, 59 };
+    static const u32 shift_count     = sizeof(decimal_shifts) / sizeof(decimal_shifts[0]);
+
+    AdjustedMantissa zero     = { 0, 0 };
+    AdjustedMantissa infinity = { 0, format.infinite_power };
+
+    if (d->num_digits == 0 || d->decimal_point < -324) return zero;
+    if (d->decimal_point >= 310)                       return infinity;
+
+    i32 exp2 = 0;
+    while (d->decimal_point > 0) {
+        u32 n     = d->decimal_point;
+        u32 shift = n < shift_count ? decimal_shifts[n] : DECIMAL_MAX_SHIFT;
+        decimal_right_shift(d, shift);
+        if (d->decimal_point < -DECIMAL_POINT_RANGE) return zero;
+        exp2 += shift;
+    }
+
+    // Shift left until the value is in [1/2, 1).
+    while (d->decimal_point <= 0) {
+        u32 shift;
+        if (d->decimal_point == 0) {
+            if (d->digits[0] >= 5) break;
+            shift = d->digits[0] < 2 ? 2 : 1;
+        } else {
+            u32 n = -d->decimal_point;
+            shift = n < shift_count ? decimal_shifts[n] : DECIMAL_MAX_SHIFT;
+        }
+
+        decimal_left_shift(d, shift);
+        if (d->decimal_point > DECIMAL_POINT_RANGE) return infinity;
+        exp2 -= shift;
+    }
+
+    // The binary format wants [1, 2).
+    --exp2;
+
+    // Subnormals: shift right until the exponent is representable.
+    while (format.minimum_exponent + 1 > exp2) {
+        u32 n = MIN((u32) (format.minimum_exponent + 1 - exp2), (u32) DECIMAL_MAX_SHIFT);
+        decimal_right_shift(d, n);
+        exp2 += n;
+    }
+
+    if (exp2 - format.minimum_exponent >= format.infinite_power) return infinity;
+
+    i32 mantissa_bits = format.mantissa_explicit_bits + 1;
+    decimal_left_shift(d, mantissa_bits);
+    u64 mantissa = decimal_round(d);
+
+    // Rounding up can carry into a new bit.
+    if (mantissa >= (1ull << mantissa_bits)) {
+        decimal_right_shift(d, 1);
+        ++exp2;
+        mantissa = decimal_round(d);
+        if (exp2 - format.minimum_exponent >= format.infinite_power) return infinity;
+    }
+
+    AdjustedMantissa ret;
+    ret.power2   = exp2 - format.minimum_exponent;
+    if (mantissa < (1ull << format.mantissa_explicit_bits)) --ret.power2;
+    ret.mantissa = mantissa & ((1ull << format.mantissa_explicit_bits) - 1);
+    return ret;
+}
+
+// append_f64() for large magnitudes and long precisions. A double has at most 767 significant decimal digits, so the
+// expansion in the big decimal is exact and rounding only has to look at the digits.
+static void append_f64_exact(Bana::StringBuilder *builder, u64 mantissa, i32 exponent, u32 precision) {
+    Decimal d = {};
+    char buf[20];
+    char *start = format_u64_backwards(buf + sizeof(buf), mantissa);
+    for (char *c = start; c < buf + sizeof(buf); ++c) d.digits[d.num_digits++] = *c - '0';
+    d.decimal_point = d.num_digits;
+    decimal_trim(&d);
+
+    for (; exponent > 0; exponent -= MIN(exponent, DECIMAL_MAX_SHIFT)) decimal_left_shift(&d, MIN(exponent, DECIMAL_MAX_SHIFT));
+    for (; exponent < 0; exponent += MIN(-exponent, DECIMAL_MAX_SHIFT)) decimal_right_shift(&d, MIN(-exponent, DECIMAL_MAX_SHIFT));
+
+    // Keep the digits up to the last printed place, rounding half to even on the rest.
+    i64 cut = (i64) d.decimal_point + precision;
+    if (cut < (i64) d.num_digits) {
+        bool round_up = false;
+        if (cut >= 0) {
+            u8 next  = d.digits[cut];
+            round_up = next > 5 || (next == 5 && (cut + 1 < d.num_digits || (cut > 0 && (d.digits[cut - 1] & 1))));
+        }
+
+        d.num_digits = (u32) MAX(cut, (i64) 0);
+
+        if (round_up) {
+            i64 i = (i64) d.num_digits - 1;
+            for (; i >= 0 && d.digits[i] == 9; --i) d.digits[i] = 0;
+
+            if (i >= 0) {
+                ++d.digits[i];
+            } else {
+                std::memmove(d.digits + 1, d.digits, d.num_digits);
+                d.digits[0] = 1;
+                ++d.num_digits;
+                ++d.decimal_point;
+            }
+        }
+    }
+
+    auto digit_at = [&d](i64 i) -> char { return '0' + (i >= 0 && i < (i64) d.num_digits ? d.digits[i] : 0); };
+
+    if (d.num_digits == 0 || d.decimal_point <= 0) {
+        builder->append('0');
+    } else {
+        for (i64 i = 0; i < d.decimal_point; ++i) builder->append(digit_at(i));
+    }
+
+    if (precision == 0) return;
+
+    builder->append('.');
+    for (u32 i = 0; i < precision; ++i) builder->append(digit_at((i64) d.decimal_point + i));
+}
+
+template<typename T>
+static T slow_parse_float(const FloatFormat &format, const char *data, usize length, bool negative) {
+    Decimal d;
+    parse_big_decimal(data, length, &d);
+    return assemble_float<T>(format, decimal_to_binary(format, &d), negative);
+}
+
+template<typename T>
+static usize parse_float_prefix(const FloatFormat &format, const char *data, usize length, T *out) {
+    static const f64 exact_powers_of_ten[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    ParsedDecimal d = parse_decimal(data, length);
+    if (d.length == 0) return 0;
+
+    if (d.nan) {
+        *out = d.negative ? -(T) NAN : (T) NAN;
+        return d.length;
+    }
+
+    if (d.inf) {
+        *out = d.negative ? -(T) INFINITY : (T) INFINITY;
+        return d.length;
+    }
+
+    // Clinger's fast path: mantissa and power of ten are both exact, so one correctly rounded operation suffices.
+    if (!d.truncated && d.mantissa <= (1ull << (format.mantissa_explicit_bits + 1)) && d.exponent >= -format.max_exponent_fast_path && d.exponent <= format.max_exponent_fast_path) {
+        T value = (T) d.mantissa;
+        if (d.exponent < 0) value = value / (T) exact_powers_of_ten[-d.exponent];
+        else                value = value * (T) exact_powers_of_ten[d.exponent];
+
+        *out = d.negative ? -value : value;
+        return d.length;
+    }
+
+    AdjustedMantissa am = eisel_lemire(format, d.exponent, d.mantissa);
+
+    // With truncated digits the true value lies between mantissa and mantissa + 1. If both round the same way, that is
+    // the answer, otherwise fall back.
+    if (d.truncated) {
+        AdjustedMantissa upper = eisel_lemire(format, d.exponent, d.mantissa + 1);
+        if (upper.mantissa != am.mantissa || upper.power2 != am.power2) {
+            *out = slow_parse_float<T>(format, data, d.length, d.negative);
+            return d.length;
+        }
+    }
+
+    *out = assemble_float<T>(format, am, d.negative);
+    return d.length;
+}
+
+usize Bana::parse_f64_prefix(const char *data, usize length, f64 *out) {
+    return parse_float_prefix<f64>(f64_format, data, length, out);
+}
+
+usize Bana::parse_f32_prefix(const char *data, usize length, f32 *out) {
+    return parse_float_prefix<f32>(f32_format, data, length, out);
+}
+
+u32 Bana::parse_dec_u32(String str) {
+    u64 value = 0;
+    if (parse_u64_prefix(str.data, str.length, &value) != str.length || value > UINT32_MAX) return 0;
+    return (u32) value;
+}
+
+u64 Bana::parse_dec_u64(String str) {
+    u64 value = 0;
+    if (parse_u64_prefix(str.data, str.length, &value) != str.length) return 0;
+    return value;
+}
+
+i64 Bana::parse_dec_i64(String str) {
+    i64 value = 0;
+    if (parse_i64_prefix(str.data, str.length, &value) != str.length) return 0;
+    return value;
+}
+
+f64 Bana::parse_dec_f64(String str) {
+    f64 value = 0.0;
+    if (parse_f64_prefix(str.data, str.length, &value) != str.length) return 0.0;
+    return value;
 }
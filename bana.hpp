@@ -14,6 +14,13 @@
 
 #include "bana_types.hpp"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #define MIN(A, B) (A < B ? A : B)
 #define MAX(A, B) (A > B ? A : B)
 #define SIGNOF(A) (A < 0 ? -1 : 1)
@@ -22,6 +29,7 @@
 #define ARRAY_LEN(a) (sizeof(a) / sizeof(a[0]))
 #define KILOBYTES(N) (N * 1024)
 #define MEGABYTES(N) (N * KILOBYTES(1024))
+#define GIGABYTES(N) (N * MEGABYTES(1024ull))
 #define BIT_CAST(TYPE, VALUE) (*((TYPE *) &VALUE)) // FIXME: This is UB I guess.
 
 #define PFBS(BANA_STRING) (i32) BANA_STRING.length, BANA_STRING.data
@@ -61,10 +69,64 @@
 #endif
 
 namespace Bana {
+// Bit tricks the containers and hashes lean on. MSVC has neither the GCC builtins nor unsigned __int128.
+// x must not be 0.
+inline u32 count_trailing_zeros32(u32 x) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return index;
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
+inline u32 count_trailing_zeros64(u64 x) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return index;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+// The full 128 bit product. Returns the low half and stores the high half in *high.
+inline u64 multiply_u64_wide(u64 a, u64 b, u64 *high) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = (unsigned __int128) a * b;
+    *high = (u64) (r >> 64);
+    return (u64) r;
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return _umul128(a, b, high);
+#else
+    u64 lo_lo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+    u64 hi_lo = (a >> 32) * (b & 0xFFFFFFFF);
+    u64 lo_hi = (a & 0xFFFFFFFF) * (b >> 32);
+    u64 hi_hi = (a >> 32) * (b >> 32);
+    u64 cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+    *high     = hi_hi + (hi_lo >> 32) + (cross >> 32);
+    return (cross << 32) | (lo_lo & 0xFFFFFFFF);
+#endif
+}
+
+enum ArenaFlags {
+    ARENA_HUGE_PAGES = 1 << 0, // Back a virtual arena with transparent huge pages where the OS supports it.
+};
+
 struct Arena {
     usize capacity;
     uptr  pointer;
     u8    *data;
+
+    // Virtual arenas only. A fixed arena (reserved == 0) wraps caller owned memory and never grows.
+    // For virtual arenas, capacity is the committed prefix of the reserved range.
+    usize reserved;
+    usize decommit_watermark;
+    u32   flags;
+
+    // Furthest the pointer has ever been. Rewinding and resetting leave it alone.
+    usize high_water;
 };
 
 #define BEGIN_TEMP_MEMORY(ARENA)        (ARENA.pointer)
@@ -72,36 +134,203 @@ struct Arena {
 #define PUSH_STRUCT(ARENA, S)           Bana::push_struct(&ARENA, &S, sizeof(S))
 #define PUSH_ARRAY(ARENA, TYPE, COUNT)  (TYPE *) Bana::push_array(&ARENA, sizeof(TYPE), COUNT)
 #define BEGIN_LIST(ARENA, TYPE)         (TYPE *) (&ARENA.data[ARENA.pointer])
-#define RESET_ARENA(ARENA)              ARENA.pointer = 0
+#define RESET_ARENA(ARENA)              Bana::reset_arena(&ARENA)
 void *push_array(Arena *arena, usize size, usize count);
 void *push_struct(Arena *arena, void *s, usize len);
 
-using AllocProc   = void *(usize);
-using FreeProc    = void (void *);
-using ReallocProc = bool (void **, usize);
+#define CACHE_LINE_SIZE 64
+
+// PUSH_ARRAY() packs allocations back to back. These pad the arena up to the requested alignment first.
+// PUSH_ARRAY_SIMD() also rounds the length up to whole cache lines so 64 byte vector loops can run over the tail.
+#define PUSH_ARRAY_ALIGNED(ARENA, TYPE, COUNT, ALIGN) (TYPE *) Bana::push_array_aligned(&ARENA, sizeof(TYPE), COUNT, ALIGN)
+#define PUSH_TYPED_ARRAY(ARENA, TYPE, COUNT)          (TYPE *) Bana::push_array_aligned(&ARENA, sizeof(TYPE), COUNT, alignof(TYPE))
+#define PUSH_ARRAY_SIMD(ARENA, TYPE, COUNT)           (TYPE *) Bana::push_array_simd(&ARENA, sizeof(TYPE), COUNT)
+void *push_array_aligned(Arena *arena, usize size, usize count, usize alignment);
+void *push_array_simd(Arena *arena, usize size, usize count);
+
+template<typename T>
+inline T *push_array_aligned(Arena *arena, usize count, usize alignment = alignof(T)) {
+    return (T *) push_array_aligned(arena, sizeof(T), count, alignment);
+}
+
+// Reserve reserve_size bytes of address space and commit pages as the arena grows. Pointers handed out by the arena
+// never move. Anything committed past decommit_watermark is returned to the OS when the arena is reset.
+Arena make_virtual_arena(usize reserve_size, usize decommit_watermark = MEGABYTES(64), u32 flags = 0);
+void free_virtual_arena(Arena *arena);
+bool arena_grow(Arena *arena, usize required_capacity);
+void arena_decommit(Arena *arena, usize keep_capacity);
+
+inline void reset_arena(Arena *arena) {
+    arena->pointer = 0;
+    if (arena->capacity > arena->decommit_watermark && arena->reserved != 0) arena_decommit(arena, arena->decommit_watermark);
+}
+
+using AllocProc   = void *(void *userdata, usize size);
+using FreeProc    = void (void *userdata, void *ptr);
+using ReallocProc = bool (void *userdata, void **ptr, usize new_size);
 
 struct Allocator {
-    AllocProc *alloc;
-    FreeProc *free;
-    ReallocProc *realloc;
+    AllocProc *alloc_proc;
+    FreeProc *free_proc;
+    ReallocProc *realloc_proc;
+    void *userdata;
+
+    inline void *alloc(usize size) {
+        return alloc_proc(userdata, size);
+    }
+
+    inline void free(void *ptr) {
+        free_proc(userdata, ptr);
+    }
+
+    inline bool realloc(void **ptr, usize new_size) {
+        return realloc_proc(userdata, ptr, new_size);
+    }
 };
 
 extern Allocator heap_allocator;
 
+struct FreeList;
+
+// Allocate out of an arena. Freeing is a no-op unless the block is the most recent allocation, in which case the arena
+// is rewound. Reallocating the most recent allocation grows or shrinks it in place.
+Allocator make_arena_allocator(Arena *arena);
+// Same as the arena allocator, but blocks must be freed in LIFO order.
+Allocator make_stack_allocator(Arena *arena);
+// Fixed size blocks out of a FreeList. Requests larger than the pool's item size fail.
+Allocator make_pool_allocator(FreeList *pool);
+// The arena an arena or stack allocator (possibly behind a tracking allocator) allocates from, nullptr for anything else.
+Arena *allocator_arena(Allocator allocator);
+
+// Size class slab allocator. Small blocks come out of 64KB spans through per-thread caches that only touch shared
+// state in batches, anything above SLAB_MAX_SMALL_SIZE is mapped directly from the OS. It can replace the default for
+// every container by assigning it to heap_allocator before anything has been allocated from the old one.
+#define SLAB_SPAN_SIZE      KILOBYTES(64)
+#define SLAB_MAX_SMALL_SIZE KILOBYTES(8)
+#define SLAB_CLASS_COUNT    32
+
+extern Allocator slab_allocator;
+
+struct SlabClassStats {
+    usize block_size;
+    usize spans;
+    usize in_use_blocks;
+    usize cached_blocks;
+    usize central_free_blocks;
+};
+
+struct SlabAllocatorStats {
+    usize mapped_bytes;  // Spans and large mappings.
+    usize in_use_bytes;  // Blocks currently handed out, at their size class size.
+    usize free_bytes;    // Carved blocks sitting in thread caches or the central free lists.
+    usize large_bytes;
+    usize large_count;
+    f64 fragmentation;   // Fraction of mapped memory not handed out.
+    SlabClassStats classes[SLAB_CLASS_COUNT];
+};
+
+// Thread caches are read without synchronization, so the numbers are approximate while other threads are allocating.
+SlabAllocatorStats slab_allocator_stats();
+// Return the calling thread's cached blocks to the shared pool. Happens automatically when the thread exits.
+void slab_allocator_flush_thread_cache();
+
+// Print an arena's current use, high-water mark, committed and reserved size.
+void print_arena_usage(const char *name, const Arena *arena);
+
+struct SpinLock {
+    bool locked;
+
+#ifdef _MSC_VER
+    // The interlocked intrinsics are full barriers. The volatile read only has to see the store eventually.
+    inline void lock() {
+        while (_InterlockedExchange8((volatile char *) &locked, 1)) {
+            while (*(volatile bool *) &locked) {
+#if defined(_M_X64) || defined(_M_IX86)
+                _mm_pause();
+#elif defined(_M_ARM64)
+                __yield();
+#endif
+            }
+        }
+    }
+
+    inline void unlock() {
+        _InterlockedExchange8((volatile char *) &locked, 0);
+    }
+#else
+    inline void lock() {
+        while (__atomic_test_and_set(&locked, __ATOMIC_ACQUIRE)) {
+            while (__atomic_load_n(&locked, __ATOMIC_RELAXED)) {
+#if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+#endif
+            }
+        }
+    }
+
+    inline void unlock() {
+        __atomic_clear(&locked, __ATOMIC_RELEASE);
+    }
+#endif
+};
+
+// Restores the arena's bump pointer when it goes out of scope. RAII version of BEGIN_TEMP_MEMORY/END_TEMP_MEMORY.
+struct TempMemory {
+    Arena *arena;
+    uptr pointer;
+
+    TempMemory(Arena *arena) : arena(arena), pointer(arena->pointer) {}
+    ~TempMemory() { arena->pointer = pointer; }
+
+    TempMemory(const TempMemory &) = delete;
+    TempMemory &operator=(const TempMemory &) = delete;
+};
+
+// Each thread gets SCRATCH_ARENA_COUNT lazily reserved virtual arenas. Pass the arenas that the caller's results live in
+// as conflicts so that the scratch arena handed back is never one of them.
+#define SCRATCH_ARENA_COUNT   2
+#define SCRATCH_ARENA_RESERVE GIGABYTES(1)
+Arena *get_scratch_arena(Arena *const *conflicts = nullptr, usize conflict_count = 0);
+// Release the calling thread's scratch arenas. Call before a thread that used scratch memory exits.
+void free_scratch_arenas();
+
+struct ScratchMemory {
+    Arena *arena;
+    uptr pointer;
+
+    ScratchMemory(Arena *conflict = nullptr) : ScratchMemory(&conflict, conflict ? 1 : 0) {}
+    // For functions that return memory from a caller supplied allocator, which may itself be scratch memory.
+    ScratchMemory(Allocator conflict) : ScratchMemory(allocator_arena(conflict)) {}
+    ScratchMemory(Arena *const *conflicts, usize conflict_count) {
+        arena   = get_scratch_arena(conflicts, conflict_count);
+        pointer = arena->pointer;
+    }
+
+    ~ScratchMemory() { arena->pointer = pointer; }
+
+    ScratchMemory(const ScratchMemory &) = delete;
+    ScratchMemory &operator=(const ScratchMemory &) = delete;
+
+    inline Allocator allocator() {
+        return make_arena_allocator(arena);
+    }
+};
+
 struct String {
     char *data;
     usize length;
     usize capacity;
 
+    // NOTE: These compare lengths first and then bytes with memcmp, so embedded null bytes are compared too.
     bool operator==(const Bana::String &rhs) const {
         if (length != rhs.length) return false;
-        return std::strncmp(data, rhs.data, length) == 0;
+        return std::memcmp(data, rhs.data, length) == 0;
     }
 
     bool operator==(const char *rhs) const {
         usize rhs_len = std::strlen(rhs);
         if (length != rhs_len) return false;
-        return std::strncmp(data, rhs, length) == 0;
+        return std::memcmp(data, rhs, length) == 0;
     }
 
     bool operator!=(const Bana::String &rhs) const {
@@ -118,9 +347,9 @@ struct String {
         return data[i];
     }
 
-    bool starts_with(const Bana::String &other) {
+    bool starts_with(const Bana::String &other) const {
         if (length < other.length) return false;
-        return std::strncmp(data, other.data, other.length) == 0;
+        return std::memcmp(data, other.data, other.length) == 0;
     }
 };
 
@@ -138,6 +367,53 @@ void string_concat(String &dst, const char *cstr);
 void string_format(String &dst, const char *fmt, ...);
 void string_strip_whitespace(String &str);
 
+struct StringChunk {
+    StringChunk *next;
+    usize length;
+    usize capacity;
+
+    inline char *data() {
+        return (char *) (this + 1);
+    }
+};
+
+// Appends into a chain of chunks, so it never has to be pre-sized and never moves what was already written. Use
+// to_string() for one contiguous copy at the end, or gather() to hand the chunks to a vectored write.
+struct StringBuilder {
+    StringChunk *first;
+    StringChunk *last;
+    usize length;
+    usize chunk_size;
+    Allocator allocator;
+
+    // Make sure the last chunk has at least count contiguous free bytes and return them. Follow up with commit().
+    char *reserve(usize count);
+    inline void commit(usize count) {
+        assert(last && last->length + count <= last->capacity);
+        last->length += count;
+        length       += count;
+    }
+
+    void append(const char *bytes, usize count);
+    void append(const String &str);
+    void append(const char *cstr);
+    void append(char c);
+    void append_u64(u64 value);
+    void append_i64(i64 value);
+    // Fixed point with precision digits after the decimal point, digit for digit what printf's %.*f gives.
+    void append_f64(f64 value, u32 precision = 6);
+    void appendf(const char *fmt, ...);
+
+    // One view per non-empty chunk, in order. Returns how many were written to views.
+    isize gather(String *views, isize max_views);
+    String to_string(Allocator allocator = heap_allocator);
+    // Drop the contents but keep the first chunk around for reuse.
+    void reset();
+};
+
+StringBuilder make_string_builder(usize chunk_size = KILOBYTES(4), Allocator allocator = heap_allocator);
+void free_string_builder(StringBuilder *sb);
+
 inline u32 utf8_char_length(u8 byte) {
     if (byte <= (u8) 0x7F) {
         return 1;
@@ -155,8 +431,19 @@ inline u32 utf8_char_length(u8 byte) {
 
 #define MAKE_STACK_STRING(NAME, CAPACITY) Bana::String NAME = { (char *) platform_alloca(CAPACITY), 0, CAPACITY }
 
+// Parse a number at the start of data without ever reading past length. No whitespace is skipped and the current
+// locale is ignored. Returns the number of bytes consumed, or 0 if there is no valid number (integer overflow included).
+usize parse_u64_prefix(const char *data, usize length, u64 *out);
+usize parse_i64_prefix(const char *data, usize length, i64 *out);
+usize parse_f64_prefix(const char *data, usize length, f64 *out);
+usize parse_f32_prefix(const char *data, usize length, f32 *out);
+
+// The whole string has to be the number. Returns 0 otherwise.
 u32 parse_hex_u32(String str);
 u32 parse_dec_u32(String str);
+u64 parse_dec_u64(String str);
+i64 parse_dec_i64(String str);
+f64 parse_dec_f64(String str);
 
 template<typename T>
 struct Optional {
@@ -245,7 +532,7 @@ struct Array {
         }
 
         capacity *= 2;
-        bool success = allocator.realloc((void **) &data, capacity * sizeof(T));
+        [[maybe_unused]] bool success = allocator.realloc((void **) &data, capacity * sizeof(T));
         assert(success && "Realloc failed.");
     }
 
@@ -254,7 +541,7 @@ struct Array {
 
         if (capacity < required_capacity) {
             capacity = required_capacity;
-            bool success = allocator.realloc((void **) &data, capacity * sizeof(T));
+            [[maybe_unused]] bool success = allocator.realloc((void **) &data, capacity * sizeof(T));
             assert(success && "Realloc failed.");
         }
     }
@@ -290,6 +577,141 @@ inline void free_array(Array<T> *array) {
     if (array && array->data) array->allocator.free(array->data);
 }
 
+// Array that keeps its first N elements inline and only goes to the allocator once it outgrows them. The elements move
+// when that happens, and the struct can be copied around freely while still inline, so always go through data().
+template<typename T, isize N>
+struct SmallArray {
+    isize size;
+    isize capacity;
+    T *heap_data;
+    Allocator allocator;
+    T inline_data[N];
+
+    inline T *data() {
+        return heap_data ? heap_data : inline_data;
+    }
+
+    inline const T *data() const {
+        return heap_data ? heap_data : inline_data;
+    }
+
+    inline bool is_inline() const {
+        return heap_data == nullptr;
+    }
+
+    isize append(T item) {
+        if (size == capacity) expand();
+
+        data()[size++] = item;
+        return size - 1;
+    }
+
+    isize index_of(T item) {
+        T *items = data();
+        for (isize i = 0; i < size; ++i) {
+            if (std::memcmp(&item, &items[i], sizeof(T)) == 0) return i;
+        }
+
+        return -1;
+    }
+
+    void insert(T item, isize idx) {
+        assert(idx >= 0 && idx <= size);
+        if (size == capacity) expand();
+
+        T *items = data();
+        std::memmove(&items[idx + 1], &items[idx], (size - idx) * sizeof(T));
+        items[idx] = item;
+        ++size;
+    }
+
+    T remove(isize i) {
+        assert(i >= 0 && i < size);
+        T *items = data();
+        if (i == size - 1) return items[--size];
+
+        T ret = items[i];
+        std::memmove(&items[i], &items[i + 1], (size - i - 1) * sizeof(T));
+        --size;
+        return ret;
+    }
+
+    void expand() {
+        ensure_capacity(capacity * 2);
+    }
+
+    void ensure_capacity(isize required_capacity) {
+        if (capacity >= required_capacity) return;
+
+        if (is_inline()) {
+            heap_data = (T *) allocator.alloc(required_capacity * sizeof(T));
+            std::memcpy(heap_data, inline_data, size * sizeof(T));
+        } else {
+            [[maybe_unused]] bool success = allocator.realloc((void **) &heap_data, required_capacity * sizeof(T));
+            assert(success && "Realloc failed.");
+        }
+
+        capacity = required_capacity;
+    }
+
+    T &operator[](isize i) {
+        assert(i < size);
+        return data()[i];
+    }
+
+    const T &operator[](isize i) const {
+        assert(i < size);
+        return data()[i];
+    }
+};
+
+template<typename T, isize N>
+inline SmallArray<T, N> make_small_array(Allocator allocator = heap_allocator) {
+    static_assert(N > 0);
+    SmallArray<T, N> ret;
+
+    ret.size      = 0;
+    ret.capacity  = N;
+    ret.heap_data = nullptr;
+    ret.allocator = allocator;
+
+    return ret;
+}
+
+template<typename T, isize N>
+inline void free_small_array(SmallArray<T, N> *array) {
+    if (array->heap_data) array->allocator.free(array->heap_data);
+    array->heap_data = nullptr;
+    array->size      = 0;
+    array->capacity  = N;
+}
+
+// Byte scanning kernels. Each has SSE2 and AVX2 versions on x86 with a scalar fallback, and picks one the first time
+// it is called based on what the CPU supports. They work on raw ranges so that both String and BufferReader can use
+// them. Searches return the index of the match or -1.
+isize find_byte(const char *data, usize length, char c);
+usize count_byte(const char *data, usize length, char c);
+isize find_any_byte(const char *data, usize length, const char *set, usize set_length);
+isize find_whitespace(const char *data, usize length);
+// Candidates are found by comparing the needle's first and last bytes a whole vector at a time and then confirmed with
+// memcmp, which keeps the scan linear in practice without any setup cost.
+isize find_substring(const char *haystack, usize haystack_length, const char *needle, usize needle_length);
+// Remove every whitespace byte in place in one pass. Returns the new length.
+usize filter_whitespace(char *data, usize length);
+
+inline isize string_find(const String &str, char c) {
+    return find_byte(str.data, str.length, c);
+}
+
+inline isize string_find_any(const String &str, const String &set) {
+    return find_any_byte(str.data, str.length, set.data, set.length);
+}
+
+// View of str without leading and trailing whitespace.
+String string_trim(const String &str);
+// Append a view of every delimiter separated field of str to out. Empty fields are kept. Returns the field count.
+isize string_split(const String &str, char delimiter, Array<String> &out);
+
 template<typename T>
 struct FixedArray {
     T *data;
@@ -348,6 +770,73 @@ void free_fixed_array(FixedArray<T> *a, Allocator allocator = heap_allocator) {
     a->capacity = 0;
 }
 
+// Allocation tracking. A TrackingAllocator wraps another allocator and hands out one Allocator per call site or tag.
+// Containers keep the Allocator they were made with, so everything a container ever allocates is charged to the place
+// that created it. Each block carries a small header naming its site and linking it into a list of live blocks, which
+// is what the leak dump walks. To track every container at once, point heap_allocator at the tracker:
+//     TrackingAllocator tracker = make_tracking_allocator(heap_allocator);
+//     heap_allocator = TRACKED_ALLOCATOR(tracker);
+// As with the slab allocator, do this before anything has been allocated from the old heap_allocator, Platform::init()
+// included. Blocks from before the swap have no tracking header, and freeing them through the tracker corrupts the heap.
+#define TRACKED_ALLOCATOR(TRACKER)     Bana::tracked_allocator(&TRACKER, __FILE__, __LINE__)
+#define TAGGED_ALLOCATOR(TRACKER, TAG) Bana::tagged_allocator(&TRACKER, TAG)
+
+// Bucket i counts requests of up to 16 << i bytes. The last bucket also takes everything bigger.
+#define TRACKING_HISTOGRAM_BUCKETS 24
+
+struct TrackedBlockHeader;
+
+struct TrackingAllocator;
+
+struct AllocationSite {
+    TrackingAllocator *tracker;
+    u32 id;           // Position in the tracker's site list, stable for the tracker's lifetime.
+    const char *tag;  // Set for tagged sites, file and line for call sites.
+    const char *file;
+    i32 line;
+    usize live_bytes;
+    usize peak_bytes;
+    usize total_bytes; // Every byte ever requested, reallocation growth included.
+    u64 live_count;
+    u64 alloc_count;
+    u64 realloc_count;
+    u64 histogram[TRACKING_HISTOGRAM_BUCKETS];
+};
+
+struct TrackingAllocator {
+    Allocator backing;
+    SpinLock lock;
+    Array<AllocationSite *> sites;
+    TrackedBlockHeader *live_blocks;
+    usize live_bytes;
+    usize peak_bytes;
+    u64 live_count;
+};
+
+// Sites point back at the tracker, so it must stay where it is once the first site has been handed out.
+TrackingAllocator make_tracking_allocator(Allocator backing = heap_allocator);
+// Every block from the tracker must be freed first. print_live_allocations() lists the ones that were not.
+void free_tracking_allocator(TrackingAllocator *tracker);
+Allocator tracked_allocator(TrackingAllocator *tracker, const char *file, i32 line);
+Allocator tagged_allocator(TrackingAllocator *tracker, const char *tag);
+
+struct AllocationSnapshot {
+    FixedArray<AllocationSite> sites; // Indexed by site id.
+    usize live_bytes;
+    usize peak_bytes;
+    u64 live_count;
+};
+
+AllocationSnapshot take_allocation_snapshot(TrackingAllocator *tracker, Allocator allocator = heap_allocator);
+void free_allocation_snapshot(AllocationSnapshot *snapshot, Allocator allocator = heap_allocator);
+// Per site totals, largest live size first. Average request size next to the histogram makes oversized
+// preallocations, like a make_array() default of 512 elements for a list that holds three, easy to spot.
+void print_allocation_report(TrackingAllocator *tracker);
+// What changed between two snapshots of the same tracker. Sites whose live size grew are the leak candidates.
+void print_allocation_diff(const AllocationSnapshot &before, const AllocationSnapshot &after);
+// List up to max_blocks live blocks, newest first, with their size and site.
+void print_live_allocations(TrackingAllocator *tracker, isize max_blocks = 32);
+
 template<typename T>
 void fixed_array_copy(FixedArray<T> &dst, FixedArray<T> &src) {
     assert(dst.capacity >= src.size);
@@ -359,9 +848,14 @@ void fixed_array_copy(FixedArray<T> &dst, FixedArray<T> &src) {
 template<typename T>
 struct Bucket {
     Bana::FixedArray<T> items;
-    Bana::FixedArray<bool> occupancy_list;
+    // One bit per slot, set when the slot is live.
+    Bana::FixedArray<u64> occupancy;
     isize filled_count;
     isize index;
+
+    inline bool is_occupied(isize slot) const {
+        return occupancy.data[slot / 64] & (1ull << (slot % 64));
+    }
 };
 
 struct BucketLocator {
@@ -371,76 +865,131 @@ struct BucketLocator {
 
 template<typename T>
 struct BucketArray {
+    // Walks only live elements, one occupancy word at a time.
+    struct Iterator {
+        BucketArray *ba;
+        isize bucket_index;
+        isize word_index;
+        u64 bits;
+
+        inline void advance() {
+            while (bits == 0) {
+                ++word_index;
+
+                if (word_index >= ba->all_buckets[bucket_index]->occupancy.size) {
+                    word_index = 0;
+                    ++bucket_index;
+                    if (bucket_index >= ba->all_buckets.size) return;
+                }
+
+                bits = ba->all_buckets[bucket_index]->occupancy.data[word_index];
+            }
+        }
+
+        inline BucketLocator locator() const {
+            return { (i32) bucket_index, (i32) (word_index * 64 + count_trailing_zeros64(bits)) };
+        }
+
+        inline T &operator*() {
+            return ba->all_buckets[bucket_index]->items.data[word_index * 64 + count_trailing_zeros64(bits)];
+        }
+
+        inline bool operator!=(const Iterator &rhs) const {
+            return bucket_index != rhs.bucket_index || word_index != rhs.word_index || bits != rhs.bits;
+        }
+
+        inline Iterator &operator++() {
+            bits &= bits - 1;
+            advance();
+            return *this;
+        }
+    };
+
     // TODO: @heap are we okay with having these arrays be heap allocated? Probably, but it's something to think about I suppose.
-    Bana::Array<Bucket<T>> all_buckets;
+    // Buckets are allocated individually and only their pointers live in all_buckets, so growing the directory never
+    // moves a bucket and the pointers in unfull_buckets stay valid.
+    Bana::Array<Bucket<T> *> all_buckets;
     Bana::Array<Bucket<T> *> unfull_buckets;
     Bana::Allocator allocator;
 
     isize size;
     isize bucket_capacity;
 
-    BucketLocator insert(T item) {
-        if (unfull_buckets.size == 0) {
-            Bucket<T> b;
-            b.filled_count   = 0;
-            b.items          = Bana::make_fixed_array<T>(bucket_capacity, allocator);
-            b.occupancy_list = Bana::make_fixed_array<bool>(bucket_capacity, allocator);
+    Bucket<T> *add_bucket() {
+        // Header, occupancy bitmap and items share a single allocation.
+        isize words         = (bucket_capacity + 63) / 64;
+        usize items_offset  = sizeof(Bucket<T>) + words * sizeof(u64);
+        items_offset        = (items_offset + alignof(T) - 1) & ~(alignof(T) - 1);
+        u8 *block           = (u8 *) allocator.alloc(items_offset + bucket_capacity * sizeof(T));
+
+        Bucket<T> *b    = (Bucket<T> *) block;
+        b->filled_count = 0;
+        b->occupancy    = { (u64 *) (b + 1), words, words };
+        b->items        = { (T *) (block + items_offset), bucket_capacity, bucket_capacity };
+        b->index        = all_buckets.append(b);
 
-            std::memset(b.occupancy_list.data, 0, bucket_capacity * sizeof(bool));
+        std::memset(b->occupancy.data, 0, words * sizeof(u64));
 
-            // FIXME: @robustness: Since this is basically a free list, we have to do this to ensure that all elements are "filled"
-            b.occupancy_list.size = b.occupancy_list.capacity;
-            b.items.size          = b.items.capacity;
+        unfull_buckets.append(b);
+        return b;
+    }
 
-            isize idx               = all_buckets.append(b);
-            Bucket<T> *added_bucket = &all_buckets[idx];
-            added_bucket->index     = idx;
+    // Allocate enough empty buckets up front for count more elements.
+    void reserve(isize count) {
+        isize free_slots = 0;
+        for (isize i = 0; i < unfull_buckets.size; ++i) free_slots += bucket_capacity - unfull_buckets[i]->filled_count;
 
-            unfull_buckets.append(added_bucket);
-        }
+        for (; free_slots < count; free_slots += bucket_capacity) add_bucket();
+    }
+
+    BucketLocator insert(T item) {
+        if (unfull_buckets.size == 0) add_bucket();
 
         assert(unfull_buckets.size != 0);
 
-        Bucket<T> *b        = unfull_buckets[0];
-        BucketLocator bl    = {};
-        for (isize i = 0; i < b->occupancy_list.size; ++i) {
-            if (!b->occupancy_list[i]) {
-                bl.bucket_index      = b->index;
-                bl.slot_index        = i;
-                b->occupancy_list[i] = true;
-                b->items[i]          = item;
-                b->filled_count++;
-
-                if (b->filled_count == b->occupancy_list.capacity) {
-                    unfull_buckets.remove(0);
-                }
+        // Always fill the most recently unfull bucket so that a bucket becoming full is popped off the back.
+        Bucket<T> *b = unfull_buckets[unfull_buckets.size - 1];
+        for (isize w = 0; w < b->occupancy.size; ++w) {
+            u64 free_bits = ~b->occupancy.data[w];
+            if (free_bits == 0) continue;
 
-                return bl;
+            // The bucket is unfull, so the lowest free bit is always a real slot and never padding in the last word.
+            isize slot = w * 64 + count_trailing_zeros64(free_bits);
+            assert(slot < bucket_capacity);
+
+            b->occupancy.data[w] |= 1ull << (slot % 64);
+            b->items[slot] = item;
+            b->filled_count++;
+            size++;
+
+            if (b->filled_count == bucket_capacity) {
+                unfull_buckets.size--;
             }
+
+            return { (i32) b->index, (i32) slot };
         }
 
         // This would imply that the bucket we selected from unfull_buckets was actually full.
-        // assert(false);
-        // __builtin_debugtrap();
-
+        assert(false);
         return {-1, -1};
     }
 
     void remove(BucketLocator bl) {
-        Bucket<T> &b = all_buckets[bl.bucket_index];
-        assert(b.occupancy_list[bl.slot_index]);
+        Bucket<T> &b = *all_buckets[bl.bucket_index];
+        assert(b.is_occupied(bl.slot_index));
 
         if (b.filled_count == bucket_capacity) {
             unfull_buckets.append(&b);
         }
 
-        b.occupancy_list[bl.slot_index] = false;
+        b.occupancy.data[bl.slot_index / 64] &= ~(1ull << (bl.slot_index % 64));
         b.filled_count--;
+        size--;
     }
 
     T &operator[](BucketLocator bl) {
-        Bucket<T> &b = all_buckets[bl.bucket_index];
-        assert(b.occupancy_list[bl.slot_index]);
+        Bucket<T> &b = *all_buckets[bl.bucket_index];
+        assert(b.is_occupied(bl.slot_index));
         return b.items[bl.slot_index];
     }
 
@@ -448,6 +997,18 @@ struct BucketArray {
         const T &v = (*this)[bl];
         return v;
     }
+
+    inline Iterator begin() {
+        if (all_buckets.size == 0) return end();
+
+        Iterator it = { this, 0, 0, all_buckets[0]->occupancy.data[0] };
+        it.advance();
+        return it;
+    }
+
+    inline Iterator end() {
+        return { this, all_buckets.size, 0, 0 };
+    }
 };
 
 template<typename T>
@@ -456,10 +1017,116 @@ BucketArray<T> make_bucket_array(isize bucket_capacity, Allocator allocator = he
 
     ba.allocator       = allocator;
     ba.bucket_capacity = bucket_capacity;
+    ba.all_buckets     = DEFER_MAKE_ARRAY(allocator);
+    ba.unfull_buckets  = DEFER_MAKE_ARRAY(allocator);
 
     return ba;
 }
 
+// All bucket memory comes out of arena, with enough buckets for reserve_count elements carved out immediately.
+template<typename T>
+BucketArray<T> make_bucket_array(isize bucket_capacity, Arena *arena, isize reserve_count) {
+    BucketArray<T> ba = make_bucket_array<T>(bucket_capacity, make_arena_allocator(arena));
+    ba.reserve(reserve_count);
+    return ba;
+}
+
+template<typename T>
+void free_bucket_array(BucketArray<T> *ba) {
+    for (isize i = 0; i < ba->all_buckets.size; ++i) ba->allocator.free(ba->all_buckets[i]);
+
+    free_array(&ba->all_buckets);
+    free_array(&ba->unfull_buckets);
+    ba->all_buckets    = DEFER_MAKE_ARRAY(ba->allocator);
+    ba->unfull_buckets = DEFER_MAKE_ARRAY(ba->allocator);
+    ba->size           = 0;
+}
+
+// wyhash (final version 4) by Wang Yi.
+inline void wymum(u64 *a, u64 *b) {
+    *a = multiply_u64_wide(*a, *b, b);
+}
+
+inline u64 wymix(u64 a, u64 b) {
+    wymum(&a, &b);
+    return a ^ b;
+}
+
+inline u64 wyread64(const u8 *p) { u64 v; std::memcpy(&v, p, sizeof(u64)); return v; }
+inline u64 wyread32(const u8 *p) { u32 v; std::memcpy(&v, p, sizeof(u32)); return v; }
+inline u64 wyread3(const u8 *p, usize k) { return ((u64) p[0] << 16) | ((u64) p[k >> 1] << 8) | p[k - 1]; }
+
+inline u64 hash_bytes(const void *key, usize length, u64 seed = 0) {
+    static constexpr u64 secret[4] = { 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull };
+
+    const u8 *p = (const u8 *) key;
+    seed ^= wymix(seed ^ secret[0], secret[1]);
+
+    u64 a, b;
+    if (length <= 16) {
+        if (length >= 4) {
+            a = (wyread32(p) << 32) | wyread32(p + ((length >> 3) << 2));
+            b = (wyread32(p + length - 4) << 32) | wyread32(p + length - 4 - ((length >> 3) << 2));
+        } else if (length > 0) {
+            a = wyread3(p, length);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        usize i = length;
+        if (i > 48) {
+            u64 seed1 = seed, seed2 = seed;
+            do {
+                seed  = wymix(wyread64(p)      ^ secret[1], wyread64(p + 8)  ^ seed);
+                seed1 = wymix(wyread64(p + 16) ^ secret[2], wyread64(p + 24) ^ seed1);
+                seed2 = wymix(wyread64(p + 32) ^ secret[3], wyread64(p + 40) ^ seed2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= seed1 ^ seed2;
+        }
+
+        while (i > 16) {
+            seed = wymix(wyread64(p) ^ secret[1], wyread64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+
+        a = wyread64(p + i - 16);
+        b = wyread64(p + i - 8);
+    }
+
+    a ^= secret[1];
+    b ^= seed;
+    wymum(&a, &b);
+    return wymix(a ^ secret[0] ^ length, b ^ secret[1]);
+}
+
+// Hash and equality hooks for HashMap. Specialize this, or pass a custom traits type, for keys that should not be
+// compared bytewise (padding, pointers to data, etc).
+template<typename Key>
+struct HashTraits {
+    static inline u64 hash(const Key &key) {
+        return hash_bytes(&key, sizeof(Key));
+    }
+
+    static inline bool equals(const Key &a, const Key &b) {
+        return std::memcmp(&a, &b, sizeof(Key)) == 0;
+    }
+};
+
+template<>
+struct HashTraits<Bana::String> {
+    static inline u64 hash(const Bana::String &key) {
+        return hash_bytes(key.data, key.length);
+    }
+
+    static inline bool equals(const Bana::String &a, const Bana::String &b) {
+        return a == b;
+    }
+};
+
 template<typename Key, typename Value>
 struct MapEntry {
     bool has_value;
@@ -489,12 +1156,7 @@ struct FixedMap {
     }
 
     inline isize hash(Key key) {
-        u32 sum = 0;
-        for (u32 i = 0; i < sizeof(Key); ++i) {
-            sum += ((u8 *) &key)[i];
-        }
-
-        return sum % capacity;
+        return hash_bytes(&key, sizeof(Key)) % capacity;
     }
 
     // NOTE: Same as put() but does not overwrite the value
@@ -563,12 +1225,7 @@ struct FixedStringMap {
     }
 
     inline isize hash(const Bana::String &key) {
-        u32 sum = 0;
-        for (u32 i = 0; i < key.length; ++i) {
-            sum += key[i];
-        }
-
-        return sum % capacity;
+        return hash_bytes(key.data, key.length) % capacity;
     }
 
     void remove(const Bana::String &key) {
@@ -604,6 +1261,7 @@ FixedMap<Key, Value> make_fixed_map(isize capacity, Allocator allocator = heap_a
     map.size     = 0;
     map.capacity = capacity;
     map.data     = (MapEntry<Key, Value> *) allocator.alloc(capacity * sizeof(MapEntry<Key, Value>));
+    std::memset(map.data, 0, capacity * sizeof(MapEntry<Key, Value>));
 
     return map;
 }
@@ -616,6 +1274,7 @@ FixedStringMap<Value> make_fixed_string_map(isize capacity, Allocator allocator
     map.capacity  = capacity;
     map.data      = (MapEntry<Bana::String, Value> *) allocator.alloc(capacity * sizeof(MapEntry<Bana::String, Value>));
     map.allocator = allocator;
+    std::memset(map.data, 0, capacity * sizeof(MapEntry<Bana::String, Value>));
 
     return map;
 }
@@ -626,54 +1285,464 @@ void free_fixed_map(FixedMap<Key, Value> *map, Allocator allocator = heap_alloca
     std::memset(map, 0, sizeof(FixedMap<Key, Value>));
 }
 
+// Control bytes for HashMap. A full slot stores the low 7 bits of its hash, so the sign bit marks empty/deleted.
+#define HASH_MAP_GROUP_WIDTH  16
+#define HASH_MAP_CTRL_EMPTY   ((i8) -128)
+#define HASH_MAP_CTRL_DELETED ((i8) -2)
+
+// Each returns a bitmask with bit i set if control byte i of the group matches.
+inline u32 hash_map_match(const i8 *group, i8 h2) {
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128((const __m128i *) group);
+    return (u32) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < HASH_MAP_GROUP_WIDTH; ++i) mask |= (u32) (group[i] == h2) << i;
+    return mask;
+#endif
+}
+
+inline u32 hash_map_match_empty(const i8 *group) {
+    return hash_map_match(group, HASH_MAP_CTRL_EMPTY);
+}
+
+inline u32 hash_map_match_empty_or_deleted(const i8 *group) {
+#ifdef __SSE2__
+    return (u32) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) group));
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < HASH_MAP_GROUP_WIDTH; ++i) mask |= (u32) (group[i] < 0) << i;
+    return mask;
+#endif
+}
+
+// SwissTable style open addressing map. Slots are probed a group of 16 control bytes at a time, removals leave
+// tombstones only when a probe sequence might run through the slot, and the table doubles at 7/8 load.
+template<typename Key, typename Value, typename Traits = HashTraits<Key>>
+struct HashMap {
+    struct Slot {
+        Key key;
+        Value value;
+    };
+
+    struct Iterator {
+        HashMap *map;
+        isize index;
+
+        inline void skip_empty() {
+            while (index < map->capacity && map->ctrl[index] < 0) ++index;
+        }
+
+        inline Slot &operator*()  { return map->slots[index]; }
+        inline Slot *operator->() { return &map->slots[index]; }
+        inline bool operator!=(const Iterator &rhs) const { return index != rhs.index; }
+
+        inline Iterator &operator++() {
+            ++index;
+            skip_empty();
+            return *this;
+        }
+    };
+
+    i8 *ctrl;
+    Slot *slots;
+    isize capacity;
+    isize size;
+    isize growth_left;
+    Allocator allocator;
+
+    inline isize find(const Key &key, u64 h) {
+        if (!ctrl) return -1;
+
+        usize group_mask = capacity / HASH_MAP_GROUP_WIDTH - 1;
+        usize g          = (h >> 7) & group_mask;
+        i8 h2            = (i8) (h & 0x7F);
+
+        // Triangular probing visits every group exactly once when the group count is a power of 2.
+        for (usize probe = 1; probe <= group_mask + 1; ++probe) {
+            const i8 *group = &ctrl[g * HASH_MAP_GROUP_WIDTH];
+
+            for (u32 m = hash_map_match(group, h2); m; m &= m - 1) {
+                isize i = g * HASH_MAP_GROUP_WIDTH + count_trailing_zeros32(m);
+                if (Traits::equals(slots[i].key, key)) return i;
+            }
+
+            if (hash_map_match_empty(group)) return -1;
+            g = (g + probe) & group_mask;
+        }
+
+        return -1;
+    }
+
+    inline isize find_insert_slot(u64 h) {
+        usize group_mask = capacity / HASH_MAP_GROUP_WIDTH - 1;
+        usize g          = (h >> 7) & group_mask;
+
+        for (usize probe = 1;; ++probe) {
+            u32 m = hash_map_match_empty_or_deleted(&ctrl[g * HASH_MAP_GROUP_WIDTH]);
+            if (m) return g * HASH_MAP_GROUP_WIDTH + count_trailing_zeros32(m);
+            g = (g + probe) & group_mask;
+        }
+    }
+
+    Bana::Optional<Value *> get(const Key &key) {
+        isize i = find(key, Traits::hash(key));
+        if (i < 0) return {};
+        return &slots[i].value;
+    }
+
+    bool contains(const Key &key) {
+        return find(key, Traits::hash(key)) >= 0;
+    }
+
+    // Insert or overwrite. Returns a pointer to the stored value, valid until the next insertion.
+    Value *put(const Key &key, const Value &value) {
+        u64 h   = Traits::hash(key);
+        isize i = find(key, h);
+
+        if (i < 0) i = insert_new(key, h);
+
+        slots[i].value = value;
+        return &slots[i].value;
+    }
+
+    // NOTE: Same as put() but does not overwrite the value of an existing key. New values are zeroed.
+    Value *slot_in(const Key &key) {
+        u64 h   = Traits::hash(key);
+        isize i = find(key, h);
+
+        if (i < 0) {
+            i = insert_new(key, h);
+            std::memset((void *) &slots[i].value, 0, sizeof(Value));
+        }
+
+        return &slots[i].value;
+    }
+
+    bool remove(const Key &key) {
+        isize i = find(key, Traits::hash(key));
+        if (i < 0) return false;
+
+        // If the group still has an empty slot, no probe sequence ever continued past it, so the slot can be reused
+        // outright instead of leaving a tombstone.
+        const i8 *group = &ctrl[(i / HASH_MAP_GROUP_WIDTH) * HASH_MAP_GROUP_WIDTH];
+        if (hash_map_match_empty(group)) {
+            ctrl[i] = HASH_MAP_CTRL_EMPTY;
+            ++growth_left;
+        } else {
+            ctrl[i] = HASH_MAP_CTRL_DELETED;
+        }
+
+        --size;
+        return true;
+    }
+
+    void clear() {
+        if (!ctrl) return;
+        std::memset(ctrl, HASH_MAP_CTRL_EMPTY, capacity);
+        size        = 0;
+        growth_left = capacity / 8 * 7;
+    }
+
+    void reserve(isize count) {
+        if (count <= size + growth_left) return;
+        rehash(count);
+    }
+
+    inline Iterator begin() {
+        Iterator it = { this, 0 };
+        if (ctrl) it.skip_empty();
+        else      it.index = capacity;
+        return it;
+    }
+
+    inline Iterator end() {
+        return { this, capacity };
+    }
+
+    isize insert_new(const Key &key, u64 h) {
+        if (!ctrl) rehash(1);
+
+        isize i = find_insert_slot(h);
+        if (growth_left == 0 && ctrl[i] == HASH_MAP_CTRL_EMPTY) {
+            // Mostly tombstones: clean up in place. Otherwise double.
+            if (size * 32 <= capacity * 25) rehash(size + 1);
+            else                            rehash(capacity * 2 / 8 * 7);
+
+            i = find_insert_slot(h);
+        }
+
+        if (ctrl[i] == HASH_MAP_CTRL_EMPTY) --growth_left;
+
+        ctrl[i]      = (i8) (h & 0x7F);
+        slots[i].key = key;
+        ++size;
+        return i;
+    }
+
+    // Rebuild the table big enough for min_count items. Tombstones are dropped, so a table that ran out of growth
+    // because of removals is rebuilt at the same size.
+    void rehash(isize min_count) {
+        isize new_capacity = HASH_MAP_GROUP_WIDTH;
+        while (new_capacity / 8 * 7 < min_count) new_capacity *= 2;
+        if (new_capacity < capacity) new_capacity = capacity;
+
+        i8 *old_ctrl       = ctrl;
+        Slot *old_slots    = slots;
+        isize old_capacity = capacity;
+
+        ctrl  = (i8 *) allocator.alloc(new_capacity + new_capacity * sizeof(Slot));
+        slots = (Slot *) (ctrl + new_capacity);
+        std::memset(ctrl, HASH_MAP_CTRL_EMPTY, new_capacity);
+
+        capacity    = new_capacity;
+        growth_left = new_capacity / 8 * 7 - size;
+
+        for (isize i = 0; i < old_capacity; ++i) {
+            if (old_ctrl[i] < 0) continue;
+
+            u64 h   = Traits::hash(old_slots[i].key);
+            isize j = find_insert_slot(h);
+            ctrl[j] = (i8) (h & 0x7F);
+            slots[j] = old_slots[i];
+        }
+
+        if (old_ctrl) allocator.free(old_ctrl);
+    }
+};
+
+template<typename Key, typename Value, typename Traits = HashTraits<Key>>
+HashMap<Key, Value, Traits> make_hash_map(isize initial_capacity = 0, Allocator allocator = heap_allocator) {
+    HashMap<Key, Value, Traits> map = {};
+    map.allocator = allocator;
+    if (initial_capacity > 0) map.rehash(initial_capacity);
+    return map;
+}
+
+template<typename Key, typename Value, typename Traits>
+void free_hash_map(HashMap<Key, Value, Traits> *map) {
+    if (map->ctrl) map->allocator.free(map->ctrl);
+    map->ctrl        = nullptr;
+    map->slots       = nullptr;
+    map->capacity    = 0;
+    map->size        = 0;
+    map->growth_left = 0;
+}
+
+// Interned strings live once in an arena and are referred to by the address of their entry, so comparing two of them
+// is a pointer compare and their hash is never recomputed.
+struct InternEntry {
+    u64 hash;
+    usize length;
+
+    inline const char *data() const {
+        return (const char *) (this + 1);
+    }
+};
+
+struct InternedString {
+    const InternEntry *entry;
+
+    inline bool operator==(const InternedString &rhs) const { return entry == rhs.entry; }
+    inline bool operator!=(const InternedString &rhs) const { return entry != rhs.entry; }
+
+    inline u64 hash() const {
+        return entry->hash;
+    }
+
+    // NOTE: Interned strings are null terminated, so data is also a valid C string.
+    inline String string() const {
+        return temp_string(entry->data(), entry->length);
+    }
+};
+
+template<>
+struct HashTraits<InternedString> {
+    static inline u64 hash(const InternedString &key) {
+        return key.entry->hash;
+    }
+
+    static inline bool equals(const InternedString &a, const InternedString &b) {
+        return a.entry == b.entry;
+    }
+};
+
+struct InternKey {
+    String str;
+    u64 hash;
+};
+
+template<>
+struct HashTraits<InternKey> {
+    static inline u64 hash(const InternKey &key) {
+        return key.hash;
+    }
+
+    static inline bool equals(const InternKey &a, const InternKey &b) {
+        return a.hash == b.hash && a.str == b.str;
+    }
+};
+
+struct InternTable {
+    Arena *arena;
+    HashMap<InternKey, InternedString> map;
+
+    Optional<InternedString> find(const String &str) {
+        InternKey key = { str, hash_bytes(str.data, str.length) };
+        auto result   = map.get(key);
+        if (!result.has_value) return {};
+        return *result.value;
+    }
+
+    InternedString intern(const String &str) {
+        InternKey key = { str, hash_bytes(str.data, str.length) };
+        auto result   = map.get(key);
+        if (result.has_value) return *result.value;
+
+        InternEntry *entry = (InternEntry *) push_array_aligned(arena, sizeof(InternEntry) + str.length + 1, 1, alignof(InternEntry));
+        entry->hash        = key.hash;
+        entry->length      = str.length;
+
+        char *data = (char *) entry->data();
+        std::memcpy(data, str.data, str.length);
+        data[str.length] = '\0';
+
+        // The key has to point at the arena copy, not the caller's string.
+        key.str = temp_string(data, str.length);
+        InternedString ret = { entry };
+        map.put(key, ret);
+        return ret;
+    }
+
+    inline InternedString intern(const char *cstr) {
+        return intern(temp_string(cstr));
+    }
+};
+
+// String bytes go into arena. The lookup table itself is allocated with allocator.
+inline InternTable make_intern_table(Arena *arena, isize initial_capacity = 0, Allocator allocator = heap_allocator) {
+    InternTable table;
+
+    table.arena = arena;
+    table.map   = make_hash_map<InternKey, InternedString>(initial_capacity, allocator);
+
+    return table;
+}
+
+// Frees the lookup table. The strings stay valid until their arena is reset.
+inline void free_intern_table(InternTable *table) {
+    free_hash_map(&table->map);
+    table->arena = nullptr;
+}
+
 #define MAKE_STACK_ARRAY(NAME, TYPE, CAPACITY) Bana::FixedArray<TYPE> NAME = { (TYPE *) platform_alloca(CAPACITY * sizeof(TYPE)), CAPACITY, 0 }
 #define INLINE_INIT_OF_STATIC_ARRAY(STATIC_ARRAY) { STATIC_ARRAY, ARRAY_LEN(STATIC_ARRAY), ARRAY_LEN(STATIC_ARRAY) }
 #define MAKE_GLOBAL_STATIC_ARRAY(NAME, TYPE, CAPACITY) static TYPE NAME##_DATA[CAPACITY]; Bana::FixedArray<TYPE> NAME = { NAME##_DATA, CAPACITY, 0 }
 
+// Define BANA_POISON_FREE_LIST to fill freed slots with FREE_LIST_POISON and check it is intact on reuse, which
+// catches writes through dangling pointers.
+#define FREE_LIST_POISON 0xDD
+
+struct FreeListSlab {
+    FreeListSlab *next;
+    usize capacity;
+};
+
+// Pool of fixed size slots. Free slots are chained through their own first bytes, so alloc and free are O(1). When
+// every slab is used up a new one of the same capacity is chained on.
 struct FreeList {
     usize item_size;
-    u8 *data;
-    FixedArray<bool> occupancy_list;
-
-    u8 *alloc(usize size) {
-        assert(size == item_size);
-        for (isize i = 0; i < occupancy_list.capacity; ++i) {
-            if (!occupancy_list[i]) {
-                occupancy_list[i] = true;
-                return data + (i * item_size);
-            }
+    usize stride;
+    usize slab_capacity;
+    u8 *free_head;
+    FreeListSlab *slabs;
+    // Slots of the newest slab past this index have never been handed out and are not on the free chain yet.
+    usize slab_cursor;
+    Allocator allocator;
+
+    inline u8 *slab_items(FreeListSlab *slab) {
+        return (u8 *) (slab + 1);
+    }
+
+    void add_slab() {
+        FreeListSlab *slab = (FreeListSlab *) allocator.alloc(sizeof(FreeListSlab) + slab_capacity * stride);
+        slab->next         = slabs;
+        slab->capacity     = slab_capacity;
+        slabs              = slab;
+        slab_cursor        = 0;
+    }
+
+    bool owns(u8 *ptr) {
+        for (FreeListSlab *slab = slabs; slab; slab = slab->next) {
+            u8 *items = slab_items(slab);
+            if (ptr >= items && ptr < items + slab->capacity * stride) return (ptr - items) % stride == 0;
+        }
+
+        return false;
+    }
+
+    u8 *alloc([[maybe_unused]] usize size) {
+        assert(size <= item_size);
+
+        if (free_head) {
+            u8 *ret = free_head;
+            std::memcpy(&free_head, ret, sizeof(u8 *));
+
+#ifdef BANA_POISON_FREE_LIST
+            for (usize i = sizeof(u8 *); i < stride; ++i) assert(ret[i] == FREE_LIST_POISON && "Freed slot was written to");
+#endif
+
+            return ret;
         }
 
-        return nullptr;
+        if (!slabs || slab_cursor == slabs->capacity) add_slab();
+        return slab_items(slabs) + stride * slab_cursor++;
     }
 
     void free(u8 *ptr) {
-        assert((usize) (ptr - data) <= occupancy_list.capacity * item_size);
-        assert((ptr - data) % item_size == 0);
-        usize idx = (ptr - data) / item_size;
-        occupancy_list[idx] = false;
+        assert(owns(ptr));
+
+#ifdef BANA_POISON_FREE_LIST
+        std::memset(ptr, FREE_LIST_POISON, stride);
+#endif
+
+        std::memcpy(ptr, &free_head, sizeof(u8 *));
+        free_head = ptr;
     }
 };
 
 inline FreeList make_free_list(usize item_size, usize capacity, Allocator allocator = heap_allocator) {
-    FreeList fl;
+    FreeList fl = {};
 
-    fl.item_size      = item_size;
-    fl.data           = (u8 *) allocator.alloc(capacity * item_size);
-    fl.occupancy_list = make_fixed_array<bool>(capacity, allocator);
+    // Every slot has to be able to hold the free chain pointer.
+    fl.item_size     = item_size;
+    fl.stride        = (MAX(item_size, sizeof(u8 *)) + alignof(u8 *) - 1) & ~(alignof(u8 *) - 1);
+    fl.slab_capacity = capacity;
+    fl.allocator     = allocator;
 
-    std::memset(fl.occupancy_list.data, 0, capacity * sizeof(bool));
+    fl.add_slab();
 
     return fl;
 }
 
+inline void free_free_list(FreeList *fl) {
+    while (fl->slabs) {
+        FreeListSlab *next = fl->slabs->next;
+        fl->allocator.free(fl->slabs);
+        fl->slabs = next;
+    }
+
+    fl->free_head   = nullptr;
+    fl->slab_cursor = 0;
+}
+
 struct BufferReader {
     char *data;
     usize size;
     usize cursor;
 
     inline bool consume(char c) {
-        if (data[cursor] != c) return false;
+        if (cursor >= size || data[cursor] != c) return false;
 
         ++cursor;
         return true;
@@ -721,32 +1790,30 @@ struct BufferReader {
         return data[cursor + 1];
     }
 
+    // The skip functions stop at the end of the buffer if there is no match, so the cursor never passes size.
     inline usize skip_to_after(char c) {
-        usize bytes_skipped = 0;
-        for (; cursor < size && data[cursor] != c; ++bytes_skipped, ++cursor);
-        ++cursor;
-        ++bytes_skipped;
-        // FIXME: What do we do if we hit the end of the file?
-        return bytes_skipped;
+        usize start = cursor;
+        skip_to_next(c);
+        if (cursor < size) ++cursor;
+        return cursor - start;
     }
 
     inline usize skip_to_next(char c) {
-        usize bytes_skipped = 0;
-        for (; cursor < size && data[cursor] != c; ++bytes_skipped, ++cursor);
-        // FIXME: What do we do if we hit the end of the file?
+        if (cursor >= size) return 0;
+
+        isize i = find_byte(&data[cursor], size - cursor, c);
+        usize bytes_skipped = i < 0 ? size - cursor : i;
+        cursor += bytes_skipped;
         return bytes_skipped;
     }
 
     inline usize skip_to_after_sequence(Bana::String seq) {
-        usize bytes_skipped = 0;
-        for (; cursor < size; ++bytes_skipped, ++cursor) {
-            if (std::strncmp(&data[cursor], seq.data, seq.length) == 0) break;
-        }
+        if (cursor >= size) return 0;
 
-        cursor += seq.length;
-        bytes_skipped += seq.length;
-        // FIXME: What do we do if we hit the end of the file?
-        return bytes_skipped;
+        usize start = cursor;
+        isize i     = find_substring(&data[cursor], size - cursor, seq.data, seq.length);
+        cursor      = i < 0 ? size : cursor + i + seq.length;
+        return cursor - start;
     }
 
     inline String slice_until(char c, Allocator allocator = heap_allocator) {
@@ -780,27 +1847,30 @@ struct BufferReader {
         return ret;
     }
 
+    // Like strtof/strtoll, leading whitespace is skipped and the cursor does not move if there is no number.
+    inline void skip_leading_whitespace() {
+        while (cursor < size && (data[cursor] == ' ' || (u8) (data[cursor] - '\t') <= 4)) ++cursor;
+    }
+
     inline f32 read_f32() {
-        if (!has_more_data()) return 0.0f;
+        usize start = cursor;
+        skip_leading_whitespace();
 
-        char *str = current_ptr();
-        char *end = nullptr;
-        f32 ret = std::strtof(str, &end);
-        cursor += (end - str);
+        f32 ret        = 0.0f;
+        usize consumed = parse_f32_prefix(current_ptr(), size - cursor, &ret);
+        cursor         = consumed ? cursor + consumed : start;
 
-        assert(cursor <= size && "FIXME: Because the string is not null terminated we ran off the end of the data into valid digits.");
         return ret;
     }
 
     inline i64 read_i64() {
-        if (!has_more_data()) return 0;
+        usize start = cursor;
+        skip_leading_whitespace();
 
-        char *str = current_ptr();
-        char *end = nullptr;
-        f32 ret = std::strtoll(str, &end, 10);
-        cursor += (end - str);
+        i64 ret        = 0;
+        usize consumed = parse_i64_prefix(current_ptr(), size - cursor, &ret);
+        cursor         = consumed ? cursor + consumed : start;
 
-        assert(cursor <= size && "FIXME: Because the string is not null terminated we ran off the end of the data into valid digits.");
         return ret;
     }
 
@@ -0,0 +1,462 @@
+// Microbenchmarks for the containers, parsers and byte scanning kernels, each next to the closest std:: equivalent.
+// Build and run from the repository root:
+//     cmake -S . -B build && cmake --build build
+//     ./build/bana_bench [--format=table|csv|json] [--filter=TEXT] [--reps=N] [--warmup=N] [--max-size=N]
+//
+// Every benchmark is run warmup times untimed and then reps times. The table reports percentiles of the wall time per
+// repetition and TSC cycles per element at the median. csv and json (one object per line) carry the same columns for
+// regression tracking. --filter keeps benchmarks whose group/workload/implementation name contains TEXT.
+
+#include "bana_platform.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace Bana;
+
+enum BenchFormat {
+    BENCH_FORMAT_TABLE,
+    BENCH_FORMAT_CSV,
+    BENCH_FORMAT_JSON,
+};
+
+struct BenchOptions {
+    BenchFormat format;
+    const char *filter;
+    u32 repetitions;
+    u32 warmup;
+    isize max_size;
+};
+
+static BenchOptions options = { BENCH_FORMAT_TABLE, nullptr, 15, 3, 1000000 };
+// Every body returns a checksum that ends up here, so the compiler cannot throw the work away.
+static volatile u64 bench_sink;
+
+static const isize bench_sizes[] = { 1000, 100000, 1000000 };
+
+static void print_header() {
+    switch (options.format) {
+    case BENCH_FORMAT_TABLE: {
+        std::printf("%-42s %10s %12s %12s %12s %12s %10s %10s\n", "benchmark", "n", "min ns", "p50 ns", "p90 ns", "p99 ns", "ns/elem", "cyc/elem");
+    } break;
+
+    case BENCH_FORMAT_CSV: {
+        std::printf("group,workload,impl,n,reps,min_ns,p50_ns,p90_ns,p99_ns,max_ns,mean_ns,ns_per_element,cycles_per_element\n");
+    } break;
+
+    case BENCH_FORMAT_JSON: break;
+    }
+}
+
+// Nearest rank percentile of sorted samples.
+static f64 percentile(const std::vector<f64> &sorted, f64 p) {
+    isize rank = (isize) (p / 100.0 * sorted.size() + 0.5);
+    rank       = std::clamp<isize>(rank, 1, sorted.size());
+    return sorted[rank - 1];
+}
+
+// Time body over n elements. setup runs before every repetition, warmup included, and is not timed. It is where the
+// previous repetition's state gets torn down and fresh input gets built.
+template<typename Setup, typename Body>
+static void bench(const char *group, const char *workload, const char *impl, isize n, Setup setup, Body body) {
+    char name[128];
+    std::snprintf(name, sizeof(name), "%s/%s/%s", group, workload, impl);
+    if (options.filter && !std::strstr(name, options.filter)) return;
+
+    for (u32 i = 0; i < options.warmup; ++i) {
+        setup();
+        bench_sink = bench_sink + body();
+    }
+
+    std::vector<f64> ns(options.repetitions);
+    std::vector<f64> cycles(options.repetitions);
+    f64 ns_per_tick = 1000000000.0 / Profiler::cpu_timer_frequency();
+
+    for (u32 i = 0; i < options.repetitions; ++i) {
+        setup();
+        u64 start  = Profiler::read_cpu_timer();
+        u64 result = body();
+        u64 end    = Profiler::read_cpu_timer();
+
+        bench_sink = bench_sink + result;
+        cycles[i]  = (f64) (end - start);
+        ns[i]      = cycles[i] * ns_per_tick;
+    }
+
+    std::sort(ns.begin(), ns.end());
+    std::sort(cycles.begin(), cycles.end());
+
+    f64 mean = 0.0;
+    for (f64 sample : ns) mean += sample;
+    mean /= ns.size();
+
+    f64 p50 = percentile(ns, 50), p90 = percentile(ns, 90), p99 = percentile(ns, 99);
+    f64 ns_per_element     = p50 / n;
+    f64 cycles_per_element = percentile(cycles, 50) / n;
+
+    switch (options.format) {
+    case BENCH_FORMAT_TABLE: {
+        std::printf("%-42s %10td %12.0f %12.0f %12.0f %12.0f %10.3f %10.3f\n", name, n, ns.front(), p50, p90, p99, ns_per_element, cycles_per_element);
+    } break;
+
+    case BENCH_FORMAT_CSV: {
+        std::printf("%s,%s,%s,%td,%u,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.4f,%.4f\n", group, workload, impl, n, options.repetitions, ns.front(), p50, p90, p99, ns.back(), mean,
+                    ns_per_element, cycles_per_element);
+    } break;
+
+    case BENCH_FORMAT_JSON: {
+        std::printf("{\"group\":\"%s\",\"workload\":\"%s\",\"impl\":\"%s\",\"n\":%td,\"reps\":%u,\"min_ns\":%.1f,\"p50_ns\":%.1f,\"p90_ns\":%.1f,\"p99_ns\":%.1f,"
+                    "\"max_ns\":%.1f,\"mean_ns\":%.1f,\"ns_per_element\":%.4f,\"cycles_per_element\":%.4f}\n",
+                    group, workload, impl, n, options.repetitions, ns.front(), p50, p90, p99, ns.back(), mean, ns_per_element, cycles_per_element);
+    } break;
+    }
+
+    std::fflush(stdout);
+}
+
+static u64 splitmix64(u64 *state) {
+    u64 z = (*state += 0x9E3779B97F4A7C15ull);
+    z     = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z     = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static std::vector<u64> random_keys(isize n, u64 seed) {
+    std::vector<u64> ret(n);
+    for (isize i = 0; i < n; ++i) ret[i] = splitmix64(&seed);
+    return ret;
+}
+
+static void bench_array(isize n) {
+    Array<u64> array = make_array<u64>();
+    std::vector<u64> vector;
+
+    bench("Array", "append", "bana", n, [&] { free_array(&array); array = make_array<u64>(); }, [&] {
+        for (isize i = 0; i < n; ++i) array.append(i);
+        return (u64) array.size;
+    });
+
+    bench("Array", "append", "std::vector", n, [&] { vector = {}; }, [&] {
+        for (isize i = 0; i < n; ++i) vector.push_back(i);
+        return (u64) vector.size();
+    });
+
+    bench("Array", "iterate", "bana", n, [] {}, [&] {
+        u64 sum = 0;
+        for (isize i = 0; i < array.size; ++i) sum += array[i];
+        return sum;
+    });
+
+    bench("Array", "iterate", "std::vector", n, [] {}, [&] {
+        u64 sum = 0;
+        for (u64 v : vector) sum += v;
+        return sum;
+    });
+
+    free_array(&array);
+}
+
+static void bench_maps(isize n) {
+    std::vector<u64> keys = random_keys(n, 1);
+
+    // FixedMap never grows, so give it the same 50% load a reserved unordered_map would settle at.
+    FixedMap<u64, u64> fixed = make_fixed_map<u64, u64>(n * 2);
+    HashMap<u64, u64> hash   = make_hash_map<u64, u64>();
+    std::unordered_map<u64, u64> std_map;
+
+    bench("U64Map", "insert", "FixedMap", n, [&] { free_fixed_map(&fixed); fixed = make_fixed_map<u64, u64>(n * 2); }, [&] {
+        for (isize i = 0; i < n; ++i) fixed.put(keys[i], i);
+        return (u64) fixed.size;
+    });
+
+    bench("U64Map", "insert", "HashMap", n, [&] { free_hash_map(&hash); hash = make_hash_map<u64, u64>(); }, [&] {
+        for (isize i = 0; i < n; ++i) hash.put(keys[i], i);
+        return (u64) hash.size;
+    });
+
+    bench("U64Map", "insert", "std::unordered_map", n, [&] { std_map = {}; }, [&] {
+        for (isize i = 0; i < n; ++i) std_map[keys[i]] = i;
+        return (u64) std_map.size();
+    });
+
+    bench("U64Map", "lookup", "FixedMap", n, [] {}, [&] {
+        u64 sum = 0;
+        for (isize i = 0; i < n; ++i) sum += *fixed.get(keys[i]).value;
+        return sum;
+    });
+
+    bench("U64Map", "lookup", "HashMap", n, [] {}, [&] {
+        u64 sum = 0;
+        for (isize i = 0; i < n; ++i) sum += *hash.get(keys[i]).value;
+        return sum;
+    });
+
+    bench("U64Map", "lookup", "std::unordered_map", n, [] {}, [&] {
+        u64 sum = 0;
+        for (isize i = 0; i < n; ++i) sum += std_map.find(keys[i])->second;
+        return sum;
+    });
+
+    free_fixed_map(&fixed);
+    free_hash_map(&hash);
+}
+
+static void free_string_map_keys(FixedStringMap<u64> *map) {
+    for (isize i = 0; i < map->capacity; ++i) {
+        if (map->data[i].has_value) free_string(&map->data[i].key, map->allocator);
+    }
+}
+
+static void bench_string_maps(isize n) {
+    std::vector<std::string> std_keys(n);
+    std::vector<String> keys(n);
+    for (isize i = 0; i < n; ++i) {
+        char buffer[32];
+        i32 length  = std::snprintf(buffer, sizeof(buffer), "key_%016td", i * 7919);
+        std_keys[i] = std::string(buffer, length);
+        keys[i]     = { std_keys[i].data(), (usize) length, (usize) length };
+    }
+
+    FixedStringMap<u64> fixed = make_fixed_string_map<u64>(n * 2);
+    std::unordered_map<std::string, u64> std_map;
+
+    bench("StringMap", "insert", "FixedStringMap", n, [&] {
+        free_string_map_keys(&fixed);
+        fixed.allocator.free(fixed.data);
+        fixed = make_fixed_string_map<u64>(n * 2);
+    }, [&] {
+        for (isize i = 0; i < n; ++i) fixed.put(keys[i], i);
+        return (u64) fixed.size;
+    });
+
+    bench("StringMap", "insert", "std::unordered_map", n, [&] { std_map = {}; }, [&] {
+        for (isize i = 0; i < n; ++i) std_map[std_keys[i]] = i;
+        return (u64) std_map.size();
+    });
+
+    bench("StringMap", "lookup", "FixedStringMap", n, [] {}, [&] {
+        u64 sum = 0;
+        for (isize i = 0; i < n; ++i) sum += *fixed.get(keys[i]).value;
+        return sum;
+    });
+
+    bench("StringMap", "lookup", "std::unordered_map", n, [] {}, [&] {
+        u64 sum = 0;
+        for (isize i = 0; i < n; ++i) sum += std_map.find(std_keys[i])->second;
+        return sum;
+    });
+
+    free_string_map_keys(&fixed);
+    fixed.allocator.free(fixed.data);
+}
+
+static void bench_bucket_array(isize n) {
+    // std::list is the std:: container that keeps element addresses stable and supports removal in the middle.
+    BucketArray<u64> buckets = make_bucket_array<u64>(1024);
+    std::list<u64> list;
+
+    bench("BucketArray", "insert", "bana", n, [&] { free_bucket_array(&buckets); }, [&] {
+        for (isize i = 0; i < n; ++i) buckets.insert(i);
+        return (u64) buckets.size;
+    });
+
+    bench("BucketArray", "insert", "std::list", n, [&] { list.clear(); }, [&] {
+        for (isize i = 0; i < n; ++i) list.push_back(i);
+        return (u64) list.size();
+    });
+
+    bench("BucketArray", "iterate", "bana", n, [] {}, [&] {
+        u64 sum = 0;
+        for (u64 v : buckets) sum += v;
+        return sum;
+    });
+
+    bench("BucketArray", "iterate", "std::list", n, [] {}, [&] {
+        u64 sum = 0;
+        for (u64 v : list) sum += v;
+        return sum;
+    });
+
+    free_bucket_array(&buckets);
+}
+
+#define BENCH_POOL_ITEM_SIZE 48
+
+static void bench_free_list(isize n) {
+    std::vector<u8 *> items(n);
+    FreeList pool = make_free_list(BENCH_POOL_ITEM_SIZE, 4096);
+
+    // Allocate everything, then free it all. The second and later repetitions run out of recycled slots.
+    bench("FreeList", "alloc_free", "bana", n, [] {}, [&] {
+        for (isize i = 0; i < n; ++i) items[i] = pool.alloc(BENCH_POOL_ITEM_SIZE);
+        u64 sum = (u64) (uptr) items[n - 1];
+        for (isize i = 0; i < n; ++i) pool.free(items[i]);
+        return sum;
+    });
+
+    bench("FreeList", "alloc_free", "malloc", n, [] {}, [&] {
+        for (isize i = 0; i < n; ++i) items[i] = (u8 *) std::malloc(BENCH_POOL_ITEM_SIZE);
+        u64 sum = (u64) (uptr) items[n - 1];
+        for (isize i = 0; i < n; ++i) std::free(items[i]);
+        return sum;
+    });
+
+    free_free_list(&pool);
+}
+
+static void bench_buffer_reader(isize n) {
+    // n lines of "<integer> <float>\n".
+    std::string text;
+    u64 seed = 2;
+    for (isize i = 0; i < n; ++i) {
+        char line[64];
+        u64 r      = splitmix64(&seed);
+        i32 length = std::snprintf(line, sizeof(line), "%lld %.4f\n", (long long) (r % 2000000) - 1000000, (f64) (r >> 40) / 1024.0);
+        text.append(line, length);
+    }
+
+    bench("BufferReader", "parse", "bana", n, [] {}, [&] {
+        BufferReader reader = { text.data(), text.size(), 0 };
+        u64 sum             = 0;
+        while (reader.has_more_data()) {
+            sum += reader.read_i64();
+            sum += (u64) reader.read_f32();
+            reader.consume('\n');
+        }
+        return sum;
+    });
+
+    bench("BufferReader", "parse", "std::from_chars", n, [] {}, [&] {
+        const char *p   = text.data();
+        const char *end = p + text.size();
+        u64 sum         = 0;
+        while (p < end) {
+            i64 integer = 0;
+            f32 number  = 0.0f;
+            p    = std::from_chars(p, end, integer).ptr + 1;
+            p    = std::from_chars(p, end, number).ptr + 1;
+            sum += integer + (u64) number;
+        }
+        return sum;
+    });
+
+    bench("BufferReader", "lines", "bana", n, [] {}, [&] {
+        BufferReader reader = { text.data(), text.size(), 0 };
+        u64 sum             = 0;
+        while (reader.has_more_data()) sum += reader.view_next_line().length;
+        return sum;
+    });
+
+    bench("BufferReader", "lines", "std::string_view", n, [] {}, [&] {
+        std::string_view view(text);
+        u64 sum = 0;
+        while (!view.empty()) {
+            usize newline = view.find('\n');
+            if (newline == std::string_view::npos) newline = view.size();
+            sum  += newline;
+            view.remove_prefix(MIN(newline + 1, view.size()));
+        }
+        return sum;
+    });
+}
+
+// Scans work on bytes, so n is scaled up to keep the buffers big enough to be worth scanning.
+#define BENCH_SCAN_BYTES_PER_ELEMENT 64
+
+static void bench_strings(isize n) {
+    isize size = n * BENCH_SCAN_BYTES_PER_ELEMENT;
+    std::string text(size, ' ');
+    u64 seed = 3;
+    for (isize i = 0; i < size; ++i) {
+        u64 r   = splitmix64(&seed) % 64;
+        text[i] = r == 0 ? '\n' : r < 4 ? ',' : (char) ('a' + r % 26);
+    }
+
+    const char needle[] = "needle in the haystack";
+    usize needle_length = sizeof(needle) - 1;
+    std::memcpy(&text[size - needle_length], needle, needle_length);
+
+    bench("String", "count_byte", "bana", size, [] {}, [&] { return (u64) count_byte(text.data(), size, '\n'); });
+    bench("String", "count_byte", "std::count", size, [] {}, [&] { return (u64) std::count(text.begin(), text.end(), '\n'); });
+
+    // Search for a byte that is not there so the whole buffer is scanned.
+    bench("String", "find_byte", "bana", size, [] {}, [&] { return (u64) find_byte(text.data(), size, '#'); });
+    bench("String", "find_byte", "memchr", size, [] {}, [&] { return (u64) (uptr) std::memchr(text.data(), '#', size); });
+
+    bench("String", "find_substring", "bana", size, [] {}, [&] { return (u64) find_substring(text.data(), size, needle, needle_length); });
+    bench("String", "find_substring", "std::string_view", size, [] {}, [&] { return (u64) std::string_view(text).find(needle); });
+
+    Array<String> fields = make_array<String>();
+    std::vector<std::string_view> std_fields;
+    String str = { text.data(), (usize) size, (usize) size };
+
+    bench("String", "split", "bana", size, [&] { fields.size = 0; }, [&] { return (u64) string_split(str, ',', fields); });
+
+    bench("String", "split", "std::string_view", size, [&] { std_fields.clear(); }, [&] {
+        std::string_view view(text);
+        for (;;) {
+            usize comma = view.find(',');
+            std_fields.push_back(view.substr(0, comma));
+            if (comma == std::string_view::npos) break;
+            view.remove_prefix(comma + 1);
+        }
+        return (u64) std_fields.size();
+    });
+
+    free_array(&fields);
+}
+
+static bool parse_option(const char *arg, const char *name, const char **value) {
+    usize length = std::strlen(name);
+    if (std::strncmp(arg, name, length) != 0 || arg[length] != '=') return false;
+    *value = arg + length + 1;
+    return true;
+}
+
+int main(int argc, char **argv) {
+    for (i32 i = 1; i < argc; ++i) {
+        const char *value;
+        if (parse_option(argv[i], "--format", &value)) {
+            if      (std::strcmp(value, "table") == 0) options.format = BENCH_FORMAT_TABLE;
+            else if (std::strcmp(value, "csv") == 0)   options.format = BENCH_FORMAT_CSV;
+            else if (std::strcmp(value, "json") == 0)  options.format = BENCH_FORMAT_JSON;
+            else {
+                ICHIGO_ERROR("Unknown format \"%s\"", value);
+                return 1;
+            }
+        } else if (parse_option(argv[i], "--filter", &value)) {
+            options.filter = value;
+        } else if (parse_option(argv[i], "--reps", &value)) {
+            options.repetitions = MAX(std::atoi(value), 1);
+        } else if (parse_option(argv[i], "--warmup", &value)) {
+            options.warmup = MAX(std::atoi(value), 0);
+        } else if (parse_option(argv[i], "--max-size", &value)) {
+            options.max_size = std::atoll(value);
+        } else {
+            ICHIGO_ERROR("Unknown argument \"%s\"", argv[i]);
+            return 1;
+        }
+    }
+
+    Platform::init();
+    print_header();
+
+    for (isize n : bench_sizes) {
+        if (n > options.max_size) break;
+
+        bench_array(n);
+        bench_maps(n);
+        bench_string_maps(n);
+        bench_bucket_array(n);
+        bench_free_list(n);
+        bench_buffer_reader(n);
+        bench_strings(n);
+    }
+
+    return 0;
+}
@@ -0,0 +1,984 @@
+#include "bana_platform.hpp"
+
+// Platform independent code built on top of the platform layer.
+
+// Hand segments to the OS, plus a sync if the policy wants one every time that happens.
+static bool file_writer_write_out(Bana::Platform::FileWriter *writer, const Bana::String *segments, isize count) {
+    if (!Bana::Platform::write_file_gather(writer->file, segments, count)) writer->failed = true;
+    else if (writer->sync_policy == Bana::Platform::WRITER_SYNC_ON_FLUSH && !Bana::Platform::sync_file(writer->file)) writer->failed = true;
+
+    return !writer->failed;
+}
+
+bool Bana::Platform::FileWriter::write_segments(const String *segments, isize count) {
+    if (failed) return false;
+
+    usize total = 0;
+    for (isize i = 0; i < count; ++i) total += segments[i].length;
+
+    if (used + total <= capacity) {
+        for (isize i = 0; i < count; ++i) {
+            std::memcpy(buffer + used, segments[i].data, segments[i].length);
+            used += segments[i].length;
+        }
+    } else {
+        ScratchMemory scratch;
+        String *gathered = (String *) scratch.allocator().alloc((count + 1) * sizeof(String));
+        gathered[0]      = { (char *) buffer, used, used };
+        std::memcpy(gathered + 1, segments, count * sizeof(String));
+
+        used = 0;
+        return file_writer_write_out(this, gathered, count + 1);
+    }
+
+    if (flush_policy == WRITER_FLUSH_ALWAYS) return flush();
+    if (flush_policy == WRITER_FLUSH_LINES) {
+        for (isize i = 0; i < count; ++i) {
+            if (find_byte(segments[i].data, segments[i].length, '\n') >= 0) return flush();
+        }
+    }
+
+    return true;
+}
+
+bool Bana::Platform::FileWriter::flush() {
+    if (failed)    return false;
+    if (used == 0) return true;
+
+    String pending = { (char *) buffer, used, used };
+    used           = 0;
+    return file_writer_write_out(this, &pending, 1);
+}
+
+bool Bana::Platform::FileWriter::sync() {
+    if (!flush()) return false;
+    if (sync_policy != WRITER_SYNC_ON_FLUSH && !sync_file(file)) failed = true;
+    return !failed;
+}
+
+Bana::Platform::FileWriter Bana::Platform::make_file_writer(File *file, usize buffer_size, WriterFlushPolicy flush_policy, WriterSyncPolicy sync_policy, Allocator allocator) {
+    FileWriter ret   = {};
+    ret.file         = file;
+    ret.buffer       = (u8 *) allocator.alloc(buffer_size);
+    ret.capacity     = buffer_size;
+    ret.flush_policy = flush_policy;
+    ret.sync_policy  = sync_policy;
+    ret.allocator    = allocator;
+    return ret;
+}
+
+bool Bana::Platform::free_file_writer(FileWriter *writer) {
+    bool ok = writer->sync_policy == WRITER_SYNC_ON_CLOSE ? writer->sync() : writer->flush();
+
+    writer->allocator.free(writer->buffer);
+    writer->buffer   = nullptr;
+    writer->capacity = 0;
+    return ok;
+}
+
+using ScanTaskProc = void (isize task, void *userdata);
+
+struct ScanWorkers {
+    ScanTaskProc *proc;
+    void *userdata;
+    isize task_count;
+    isize next_task;
+};
+
+static void scan_worker(void *userdata) {
+    ScanWorkers *workers = (ScanWorkers *) userdata;
+
+    for (;;) {
+        isize task = __atomic_fetch_add(&workers->next_task, 1, __ATOMIC_RELAXED);
+        if (task >= workers->task_count) return;
+        workers->proc(task, workers->userdata);
+    }
+}
+
+static void scan_task_range(isize begin, isize end, void *userdata) {
+    ScanWorkers *workers = (ScanWorkers *) userdata;
+    for (isize task = begin; task < end; ++task) workers->proc(task, workers->userdata);
+}
+
+// Run task_count tasks on the job system if it is up, or otherwise on up to thread_count threads started just for this.
+// The calling thread pulls tasks too, so a failure to start a helper only costs parallelism.
+static void run_scan_tasks(u32 thread_count, isize task_count, ScanTaskProc *proc, void *userdata) {
+    ScanWorkers workers = { proc, userdata, task_count, 0 };
+    if (Bana::Platform::job_system_running()) {
+        Bana::Platform::parallel_for(0, task_count, 1, scan_task_range, &workers);
+        return;
+    }
+
+    isize helper_count  = MIN((isize) thread_count, task_count) - 1;
+
+    Bana::ScratchMemory scratch;
+    Bana::Platform::Thread **helpers = (Bana::Platform::Thread **) scratch.allocator().alloc(MAX(helper_count, 1) * sizeof(Bana::Platform::Thread *));
+    for (isize i = 0; i < helper_count; ++i) helpers[i] = Bana::Platform::create_thread(scan_worker, &workers);
+
+    scan_worker(&workers);
+
+    for (isize i = 0; i < helper_count; ++i) {
+        if (helpers[i]) Bana::Platform::join_thread(helpers[i]);
+    }
+}
+
+static u32 scan_thread_count(const Bana::ScanOptions &options) {
+    return options.thread_count ? options.thread_count : Bana::Platform::processor_count();
+}
+
+isize Bana::scan_chunk_limit(usize size, const ScanOptions &options) {
+    isize by_threads = (isize) scan_thread_count(options) * SCAN_CHUNKS_PER_THREAD;
+    isize by_size    = options.min_chunk_size ? size / options.min_chunk_size : size;
+    return MAX(MIN(by_threads, by_size), 1);
+}
+
+// Index just past the first delimiter at or after from that is outside quotes, or size if there is none.
+static usize find_record_end(const char *data, usize size, usize from, const Bana::ScanOptions &options, bool in_quotes) {
+    if (!options.quote_aware) {
+        isize i = Bana::find_byte(data + from, size - from, options.delimiter);
+        return i < 0 ? size : from + i + 1;
+    }
+
+    const char set[] = { options.delimiter, options.quote };
+    while (from < size) {
+        isize i = Bana::find_any_byte(data + from, size - from, set, ARRAY_LEN(set));
+        if (i < 0) return size;
+
+        from += i;
+        if (data[from] == options.quote) in_quotes = !in_quotes;
+        else if (!in_quotes)             return from + 1;
+        ++from;
+    }
+
+    return size;
+}
+
+struct QuoteCountTask {
+    const char *data;
+    const usize *starts;
+    usize *counts;
+    char quote;
+};
+
+static void count_quotes(isize task, void *userdata) {
+    QuoteCountTask *t = (QuoteCountTask *) userdata;
+    t->counts[task]   = Bana::count_byte(t->data + t->starts[task], t->starts[task + 1] - t->starts[task], t->quote);
+}
+
+// The buffer is cut at evenly spaced offsets and each cut is moved forward to the next record end. For quote aware
+// splits, the quote state at each cut comes from the parity of the quotes before it, which is counted in parallel since
+// it means reading the whole buffer. Every cut lands on the first real record end after its offset, so the cuts are
+// already in order and two cuts landing on the same record end (a record longer than a chunk) just merge their chunks.
+isize Bana::split_records(const BufferReader &buffer, const ScanOptions &options, BufferReader *chunks, isize max_chunks) {
+    const char *data = buffer.data + buffer.cursor;
+    usize size       = buffer.size - buffer.cursor;
+    if (size == 0 || max_chunks <= 0) return 0;
+
+    isize cut_count = MIN(max_chunks, (isize) size);
+
+    ScratchMemory scratch;
+    usize *starts = (usize *) scratch.allocator().alloc((cut_count + 1) * sizeof(usize));
+    for (isize i = 0; i <= cut_count; ++i) starts[i] = (usize) ((unsigned __int128) size * i / cut_count);
+
+    usize *quote_counts = nullptr;
+    if (options.quote_aware && cut_count > 1) {
+        quote_counts        = (usize *) scratch.allocator().alloc(cut_count * sizeof(usize));
+        QuoteCountTask task = { data, starts, quote_counts, options.quote };
+        run_scan_tasks(scan_thread_count(options), cut_count, count_quotes, &task);
+    }
+
+    isize chunk_count = 0;
+    usize chunk_start = 0;
+    usize quotes_seen = 0;
+
+    for (isize i = 1; i <= cut_count && chunk_start < size; ++i) {
+        usize chunk_end = size;
+        if (i < cut_count) {
+            if (quote_counts) quotes_seen += quote_counts[i - 1];
+            chunk_end = find_record_end(data, size, starts[i], options, quotes_seen & 1);
+        }
+
+        if (chunk_end <= chunk_start) continue;
+
+        chunks[chunk_count++] = { (char *) data + chunk_start, chunk_end - chunk_start, 0 };
+        chunk_start           = chunk_end;
+    }
+
+    return chunk_count;
+}
+
+struct ScanChunkTask {
+    Bana::BufferReader *chunks;
+    Bana::ScanProc *proc;
+    void *userdata;
+};
+
+static void scan_chunk(isize task, void *userdata) {
+    ScanChunkTask *t = (ScanChunkTask *) userdata;
+    t->proc(&t->chunks[task], task, t->userdata);
+}
+
+isize Bana::parallel_scan(const BufferReader &buffer, const ScanOptions &options, ScanProc *proc, void *userdata) {
+    ScratchMemory scratch;
+    isize max_chunks     = scan_chunk_limit(buffer.size - buffer.cursor, options);
+    BufferReader *chunks = (BufferReader *) scratch.allocator().alloc(max_chunks * sizeof(BufferReader));
+    isize chunk_count    = split_records(buffer, options, chunks, max_chunks);
+
+    ScanChunkTask task = { chunks, proc, userdata };
+    run_scan_tasks(scan_thread_count(options), chunk_count, scan_chunk, &task);
+
+    return chunk_count;
+}
+
+// Job system.
+//
+// Deque operations follow Lê, Pop, Cohen and Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak Memory
+// Models". The deque never grows: a worker whose deque is full spills into the shared queue. Jobs are three words, so
+// slots are copied field by field with relaxed atomics; a thief that reads a slot the owner is overwriting always
+// loses the CAS on top afterwards and throws the copy away.
+#define JOB_SPIN_COUNT 64
+
+struct Bana::Platform::JobContinuation {
+    Job job;
+    JobContinuation *next;
+};
+
+struct JobDeque {
+    alignas(CACHE_LINE_SIZE) isize top;
+    alignas(CACHE_LINE_SIZE) isize bottom;
+    alignas(CACHE_LINE_SIZE) Bana::Platform::Job jobs[JOB_DEQUE_CAPACITY];
+};
+
+struct JobWorker {
+    JobDeque deque;
+    Bana::Platform::Thread *thread;
+    u32 index;
+    u64 rng;
+};
+
+struct JobSystem {
+    Bana::Arena arena;
+    JobWorker *workers;
+    u32 worker_count;
+
+    // Jobs from threads outside the pool, first in first out.
+    Bana::Platform::Mutex *injected_lock;
+    Bana::Array<Bana::Platform::Job> injected;
+    isize injected_head;
+    isize injected_pending;
+
+    Bana::Platform::Semaphore *wake;
+    u32 sleeping;
+    bool quit;
+    bool running;
+};
+
+static JobSystem job_system;
+thread_local static JobWorker *current_worker = nullptr;
+thread_local static u64 outside_rng           = 0;
+
+using namespace Bana::Platform;
+
+static inline void store_job(Job *slot, const Job &job) {
+    atomic_store(&slot->proc, job.proc, MEMORY_ORDER_RELAXED);
+    atomic_store(&slot->userdata, job.userdata, MEMORY_ORDER_RELAXED);
+    atomic_store(&slot->counter, job.counter, MEMORY_ORDER_RELAXED);
+}
+
+static inline void load_job(const Job *slot, Job *job) {
+    job->proc     = atomic_load(&slot->proc, MEMORY_ORDER_RELAXED);
+    job->userdata = atomic_load(&slot->userdata, MEMORY_ORDER_RELAXED);
+    job->counter  = atomic_load(&slot->counter, MEMORY_ORDER_RELAXED);
+}
+
+// Owner only.
+static bool deque_push(JobDeque *deque, const Job &job) {
+    isize b = atomic_load(&deque->bottom, MEMORY_ORDER_RELAXED);
+    isize t = atomic_load(&deque->top, MEMORY_ORDER_ACQUIRE);
+    if (b - t >= JOB_DEQUE_CAPACITY) return false;
+
+    store_job(&deque->jobs[b & (JOB_DEQUE_CAPACITY - 1)], job);
+    atomic_store(&deque->bottom, b + 1, MEMORY_ORDER_RELEASE);
+    return true;
+}
+
+// Owner only. Takes the most recently pushed job, which is the one most likely to still be in cache.
+static bool deque_pop(JobDeque *deque, Job *job) {
+    isize b = atomic_load(&deque->bottom, MEMORY_ORDER_RELAXED) - 1;
+    atomic_store(&deque->bottom, b, MEMORY_ORDER_RELAXED);
+    atomic_fence(MEMORY_ORDER_SEQ_CST);
+    isize t = atomic_load(&deque->top, MEMORY_ORDER_RELAXED);
+
+    if (t > b) {
+        atomic_store(&deque->bottom, b + 1, MEMORY_ORDER_RELAXED);
+        return false;
+    }
+
+    load_job(&deque->jobs[b & (JOB_DEQUE_CAPACITY - 1)], job);
+    if (t < b) return true;
+
+    // Last job. Race the thieves for it.
+    bool won = atomic_compare_exchange(&deque->top, &t, t + 1, MEMORY_ORDER_SEQ_CST, MEMORY_ORDER_RELAXED);
+    atomic_store(&deque->bottom, b + 1, MEMORY_ORDER_RELAXED);
+    return won;
+}
+
+// Any thread. Takes the oldest job.
+static bool deque_steal(JobDeque *deque, Job *job) {
+    isize t = atomic_load(&deque->top, MEMORY_ORDER_ACQUIRE);
+    atomic_fence(MEMORY_ORDER_SEQ_CST);
+    isize b = atomic_load(&deque->bottom, MEMORY_ORDER_ACQUIRE);
+    if (t >= b) return false;
+
+    load_job(&deque->jobs[t & (JOB_DEQUE_CAPACITY - 1)], job);
+    return atomic_compare_exchange(&deque->top, &t, t + 1, MEMORY_ORDER_SEQ_CST, MEMORY_ORDER_RELAXED);
+}
+
+static u64 next_random(u64 *state) {
+    if (*state == 0) *state = (u64) (uptr) state | 1;
+
+    u64 x   = *state;
+    x      ^= x << 13;
+    x      ^= x >> 7;
+    x      ^= x << 17;
+    *state  = x;
+    return x;
+}
+
+static bool take_injected_job(Job *job) {
+    if (atomic_load(&job_system.injected_pending, MEMORY_ORDER_RELAXED) == 0) return false;
+
+    bool found = false;
+    lock_mutex(job_system.injected_lock);
+
+    if (job_system.injected_head < job_system.injected.size) {
+        *job  = job_system.injected[job_system.injected_head++];
+        found = true;
+
+        if (job_system.injected_head == job_system.injected.size) {
+            job_system.injected_head  = 0;
+            job_system.injected.size  = 0;
+        }
+    }
+
+    atomic_store(&job_system.injected_pending, job_system.injected.size - job_system.injected_head, MEMORY_ORDER_RELAXED);
+    unlock_mutex(job_system.injected_lock);
+
+    return found;
+}
+
+static bool find_job(JobWorker *worker, Job *job) {
+    if (worker && deque_pop(&worker->deque, job)) return true;
+    if (take_injected_job(job))                   return true;
+
+    u32 count = job_system.worker_count;
+    u32 start = (u32) next_random(worker ? &worker->rng : &outside_rng) % count;
+    for (u32 i = 0; i < count; ++i) {
+        JobWorker *victim = &job_system.workers[(start + i) % count];
+        if (victim != worker && deque_steal(&victim->deque, job)) return true;
+    }
+
+    return false;
+}
+
+// Pairs with the fence between a worker announcing it is going to sleep and its last look for work, so either the
+// worker sees the job or we see the sleeper.
+static void wake_sleeper() {
+    atomic_fence(MEMORY_ORDER_SEQ_CST);
+    if (atomic_load(&job_system.sleeping, MEMORY_ORDER_RELAXED) > 0) signal_semaphore(job_system.wake);
+}
+
+static void submit_job(const Job &job) {
+    if (!current_worker || !deque_push(&current_worker->deque, job)) {
+        lock_mutex(job_system.injected_lock);
+        job_system.injected.append(job);
+        atomic_store(&job_system.injected_pending, job_system.injected.size - job_system.injected_head, MEMORY_ORDER_RELAXED);
+        unlock_mutex(job_system.injected_lock);
+    }
+
+    wake_sleeper();
+}
+
+static void lock_counter(JobCounter *counter) {
+    while (atomic_exchange(&counter->locked, true, MEMORY_ORDER_ACQUIRE)) cpu_relax();
+}
+
+static void unlock_counter(JobCounter *counter) {
+    atomic_store(&counter->locked, false, MEMORY_ORDER_RELEASE);
+}
+
+// Whoever takes a counter to zero holds its lock while doing so and waiters wait for the lock too, so the counter can
+// live on the waiter's stack: nothing touches it once the waiter is able to return.
+static void finish_job(JobCounter *counter) {
+    i64 pending = atomic_load(&counter->pending, MEMORY_ORDER_RELAXED);
+    while (pending > 1) {
+        if (atomic_compare_exchange(&counter->pending, &pending, pending - 1, MEMORY_ORDER_ACQ_REL, MEMORY_ORDER_RELAXED)) return;
+    }
+
+    lock_counter(counter);
+    JobContinuation *continuation = counter->continuations;
+    counter->continuations        = nullptr;
+    atomic_fetch_sub(&counter->pending, (i64) 1, MEMORY_ORDER_ACQ_REL);
+    unlock_counter(counter);
+
+    while (continuation) {
+        JobContinuation *next = continuation->next;
+        submit_job(continuation->job);
+        Bana::slab_allocator.free(continuation);
+        continuation = next;
+    }
+}
+
+static void execute_job(const Job &job) {
+    job.proc(job.userdata);
+    if (job.counter) finish_job(job.counter);
+}
+
+static void job_worker_main(void *userdata) {
+    JobWorker *worker = (JobWorker *) userdata;
+    current_worker    = worker;
+    u32 idle          = 0;
+
+    while (!atomic_load(&job_system.quit, MEMORY_ORDER_ACQUIRE)) {
+        Job job;
+        if (find_job(worker, &job)) {
+            execute_job(job);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < JOB_SPIN_COUNT) {
+            cpu_relax();
+            continue;
+        }
+
+        atomic_fetch_add(&job_system.sleeping, 1u);
+        atomic_fence(MEMORY_ORDER_SEQ_CST);
+
+        if (find_job(worker, &job)) {
+            atomic_fetch_sub(&job_system.sleeping, 1u);
+            execute_job(job);
+        } else {
+            if (!atomic_load(&job_system.quit, MEMORY_ORDER_ACQUIRE)) wait_semaphore(job_system.wake);
+            atomic_fetch_sub(&job_system.sleeping, 1u);
+        }
+
+        idle = 0;
+    }
+
+    current_worker = nullptr;
+}
+
+void Bana::Platform::init_job_system(u32 worker_count) {
+    assert(!job_system.running);
+
+    if (worker_count == 0) worker_count = processor_count();
+
+    job_system                = {};
+    job_system.arena          = make_virtual_arena(sizeof(JobWorker) * worker_count + MEGABYTES(1));
+    job_system.workers        = push_array_aligned<JobWorker>(&job_system.arena, worker_count);
+    job_system.worker_count   = worker_count;
+    job_system.injected_lock  = create_mutex();
+    job_system.injected       = make_array<Job>(64);
+    job_system.wake           = create_semaphore();
+    job_system.running        = true;
+
+    for (u32 i = 0; i < worker_count; ++i) {
+        JobWorker *worker = &job_system.workers[i];
+        std::memset((void *) worker, 0, sizeof(JobWorker));
+        worker->index = i;
+        worker->rng   = 0x9E3779B97F4A7C15ull * (i + 1);
+    }
+
+    current_worker = &job_system.workers[0];
+    for (u32 i = 1; i < worker_count; ++i) {
+        job_system.workers[i].thread = create_thread(job_worker_main, &job_system.workers[i]);
+    }
+}
+
+void Bana::Platform::shutdown_job_system() {
+    assert(job_system.running);
+
+    atomic_store(&job_system.quit, true, MEMORY_ORDER_RELEASE);
+    signal_semaphore(job_system.wake, job_system.worker_count);
+
+    for (u32 i = 1; i < job_system.worker_count; ++i) {
+        if (job_system.workers[i].thread) join_thread(job_system.workers[i].thread);
+    }
+
+    destroy_semaphore(job_system.wake);
+    destroy_mutex(job_system.injected_lock);
+    free_array(&job_system.injected);
+    free_virtual_arena(&job_system.arena);
+
+    current_worker = nullptr;
+    job_system     = {};
+}
+
+bool Bana::Platform::job_system_running() {
+    return job_system.running;
+}
+
+u32 Bana::Platform::job_worker_count() {
+    return job_system.worker_count;
+}
+
+i32 Bana::Platform::job_worker_index() {
+    return current_worker ? (i32) current_worker->index : -1;
+}
+
+void Bana::Platform::run_job(JobProc *proc, void *userdata, JobCounter *counter) {
+    assert(job_system.running);
+
+    if (counter) atomic_fetch_add(&counter->pending, (i64) 1, MEMORY_ORDER_RELAXED);
+    submit_job({ proc, userdata, counter });
+}
+
+void Bana::Platform::run_jobs(const Job *jobs, isize count) {
+    assert(job_system.running);
+
+    for (isize i = 0; i < count; ++i) {
+        if (jobs[i].counter) atomic_fetch_add(&jobs[i].counter->pending, (i64) 1, MEMORY_ORDER_RELAXED);
+    }
+
+    for (isize i = 0; i < count; ++i) submit_job(jobs[i]);
+}
+
+void Bana::Platform::run_job_after(JobCounter *dependency, JobProc *proc, void *userdata, JobCounter *counter) {
+    assert(job_system.running);
+
+    if (counter) atomic_fetch_add(&counter->pending, (i64) 1, MEMORY_ORDER_RELAXED);
+
+    lock_counter(dependency);
+    if (atomic_load(&dependency->pending, MEMORY_ORDER_ACQUIRE) > 0) {
+        JobContinuation *continuation = (JobContinuation *) slab_allocator.alloc(sizeof(JobContinuation));
+        continuation->job             = { proc, userdata, counter };
+        continuation->next            = dependency->continuations;
+        dependency->continuations     = continuation;
+        unlock_counter(dependency);
+        return;
+    }
+
+    unlock_counter(dependency);
+    submit_job({ proc, userdata, counter });
+}
+
+void Bana::Platform::wait_for_counter(JobCounter *counter) {
+    u32 idle = 0;
+
+    while (atomic_load(&counter->pending, MEMORY_ORDER_ACQUIRE) > 0 || atomic_load(&counter->locked, MEMORY_ORDER_ACQUIRE)) {
+        Job job;
+        if (job_system.running && find_job(current_worker, &job)) {
+            execute_job(job);
+            idle = 0;
+        } else if (++idle < JOB_SPIN_COUNT) {
+            cpu_relax();
+        } else {
+            yield_thread();
+        }
+    }
+}
+
+struct ParallelFor {
+    RangeProc *proc;
+    void *userdata;
+    isize end;
+    isize grain;
+    isize next;
+};
+
+static void parallel_for_job(void *userdata) {
+    ParallelFor *range = (ParallelFor *) userdata;
+
+    for (;;) {
+        isize begin = atomic_fetch_add(&range->next, range->grain, MEMORY_ORDER_RELAXED);
+        if (begin >= range->end) return;
+        range->proc(begin, MIN(begin + range->grain, range->end), range->userdata);
+    }
+}
+
+void Bana::Platform::parallel_for(isize begin, isize end, isize grain, RangeProc *proc, void *userdata) {
+    if (end <= begin) return;
+
+    isize count   = end - begin;
+    isize workers = job_system.running ? job_system.worker_count : 1;
+    if (grain <= 0) grain = MAX(count / (workers * 8), 1);
+
+    isize range_count = (count + grain - 1) / grain;
+    if (!job_system.running || range_count == 1) {
+        for (isize i = begin; i < end; i += grain) proc(i, MIN(i + grain, end), userdata);
+        return;
+    }
+
+    // The calling thread claims ranges too, so one fewer job than workers is enough to keep everyone busy.
+    ParallelFor range  = { proc, userdata, end, grain, begin };
+    JobCounter counter = {};
+    isize job_count    = MIN(range_count, workers) - 1;
+    for (isize i = 0; i < job_count; ++i) run_job(parallel_for_job, &range, &counter);
+
+    parallel_for_job(&range);
+    wait_for_counter(&counter);
+}
+
+// Profiler. Each thread owns a ProfilerThread that only it writes to. The log is a chain of fixed size blocks; an
+// event's slot is filled before the block's count is bumped with a release store, and new blocks are linked the same
+// way, so an exporter can walk the log while it is still growing. ProfilerThreads are linked into a global list with
+// a CAS when a thread first enters a zone and are kept after the thread exits so its events can still be exported.
+// Profiler memory comes straight from calloc so it never shows up in anything watching heap_allocator.
+struct ProfilerOpenZone {
+    Bana::Profiler::ZoneSite *site;
+    u32 index;
+    u64 begin;
+    u64 children;
+};
+
+struct ProfilerEvent {
+    Bana::Profiler::ZoneSite *site;
+    u64 begin;
+    u64 end;
+};
+
+struct ProfilerBlock {
+    ProfilerBlock *next;
+    u32 count;
+    ProfilerEvent events[PROFILER_BLOCK_SIZE];
+};
+
+struct ProfilerSiteTotals {
+    u64 count;
+    u64 inclusive;
+    u64 exclusive;
+    u32 active; // How many times the site is open on this thread's stack right now.
+};
+
+struct ProfilerThread {
+    ProfilerThread *next;
+    u32 id;
+    u32 depth;
+    u32 dropped_depth; // Zones opened past PROFILER_MAX_DEPTH that are still open. They are not recorded.
+    ProfilerBlock *first;
+    ProfilerBlock *last;
+    ProfilerOpenZone stack[PROFILER_MAX_DEPTH];
+    ProfilerSiteTotals totals[PROFILER_MAX_SITES];
+};
+
+static ProfilerThread *profiler_threads;
+static u32 profiler_thread_count;
+static Bana::Profiler::ZoneSite *profiler_sites[PROFILER_MAX_SITES];
+static u32 profiler_site_count;
+static Bana::SpinLock profiler_sites_lock;
+static u64 profiler_epoch;
+static bool profiler_logging = true;
+static thread_local ProfilerThread *profiler_thread;
+
+static ProfilerThread *profiler_register_thread() {
+    using namespace Bana::Platform;
+
+    ProfilerThread *thread = (ProfilerThread *) std::calloc(1, sizeof(ProfilerThread));
+    assert(thread);
+    thread->id = atomic_fetch_add(&profiler_thread_count, (u32) 1) + 1;
+
+    u64 no_epoch = 0;
+    atomic_compare_exchange(&profiler_epoch, &no_epoch, Bana::Profiler::read_cpu_timer());
+
+    ProfilerThread *head = atomic_load(&profiler_threads, MEMORY_ORDER_RELAXED);
+    do {
+        thread->next = head;
+    } while (!atomic_compare_exchange(&profiler_threads, &head, thread, MEMORY_ORDER_RELEASE, MEMORY_ORDER_RELAXED));
+
+    profiler_thread = thread;
+    return thread;
+}
+
+static u32 profiler_register_site(Bana::Profiler::ZoneSite *site) {
+    using namespace Bana::Platform;
+
+    // Registration only happens the first time a site is entered, so a lock costs nothing and means racing threads
+    // cannot use up more than one slot per site.
+    profiler_sites_lock.lock();
+    u32 index = atomic_load(&site->index, MEMORY_ORDER_RELAXED);
+    if (!index) {
+        if (profiler_site_count < PROFILER_MAX_SITES) {
+            u32 slot = profiler_site_count;
+            atomic_store(&profiler_sites[slot], site, MEMORY_ORDER_RELEASE);
+            atomic_store(&profiler_site_count, slot + 1, MEMORY_ORDER_RELEASE);
+            index = slot + 1;
+        } else {
+            ICHIGO_ERROR("Too many profiler zones, %s (%s:%d) will not be recorded. Raise PROFILER_MAX_SITES.", site->name, site->file, site->line);
+            index = PROFILER_SITE_DROPPED;
+        }
+
+        atomic_store(&site->index, index, MEMORY_ORDER_RELEASE);
+    }
+    profiler_sites_lock.unlock();
+
+    return index;
+}
+
+static void profiler_log_event(ProfilerThread *thread, Bana::Profiler::ZoneSite *site, u64 begin, u64 end) {
+    using namespace Bana::Platform;
+
+    ProfilerBlock *block = thread->last;
+    if (!block || block->count == PROFILER_BLOCK_SIZE) {
+        ProfilerBlock *new_block = (ProfilerBlock *) std::calloc(1, sizeof(ProfilerBlock));
+        assert(new_block);
+
+        if (block) atomic_store(&block->next, new_block, MEMORY_ORDER_RELEASE);
+        else       atomic_store(&thread->first, new_block, MEMORY_ORDER_RELEASE);
+        thread->last = block = new_block;
+    }
+
+    block->events[block->count] = { site, begin, end };
+    atomic_store(&block->count, block->count + 1, MEMORY_ORDER_RELEASE);
+}
+
+static void profiler_free_blocks(ProfilerBlock *block) {
+    while (block) {
+        ProfilerBlock *next = block->next;
+        std::free(block);
+        block = next;
+    }
+}
+
+f64 Bana::Profiler::cpu_timer_frequency() {
+    static u64 frequency = 0;
+
+    u64 cached = Platform::atomic_load(&frequency, Platform::MEMORY_ORDER_RELAXED);
+    if (cached) return (f64) cached;
+
+    f64 ret;
+#if defined(__x86_64__) || defined(__i386__)
+    f64 start_time = Platform::get_current_time();
+    u64 start      = read_cpu_timer();
+    f64 elapsed    = 0.0;
+    while (elapsed < 0.01) elapsed = Platform::get_current_time() - start_time;
+    ret = (f64) (read_cpu_timer() - start) / elapsed;
+#elif defined(__aarch64__)
+    u64 hz;
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(hz));
+    ret = (f64) hz;
+#else
+    ret = 1000000000.0;
+#endif
+
+    Platform::atomic_store(&frequency, (u64) ret, Platform::MEMORY_ORDER_RELAXED);
+    return ret;
+}
+
+void Bana::Profiler::begin_zone(ZoneSite *site) {
+    ProfilerThread *thread = profiler_thread;
+    if (!thread) thread = profiler_register_thread();
+
+    u32 index = Platform::atomic_load(&site->index, Platform::MEMORY_ORDER_ACQUIRE);
+    if (!index) index = profiler_register_site(site);
+    if (index == PROFILER_SITE_DROPPED) return;
+
+    // Zones are strictly nested, so anything opened while the stack is full closes before any recorded zone does.
+    if (thread->depth == PROFILER_MAX_DEPTH || thread->dropped_depth > 0) {
+        thread->dropped_depth++;
+        return;
+    }
+
+    thread->totals[index - 1].active++;
+
+    ProfilerOpenZone *zone = &thread->stack[thread->depth++];
+    zone->site             = site;
+    zone->index            = index;
+    zone->children         = 0;
+    // Read the timer last so the bookkeeping above is not charged to the zone.
+    zone->begin            = read_cpu_timer();
+}
+
+void Bana::Profiler::end_zone(ZoneSite *site) {
+    u64 end                = read_cpu_timer();
+    ProfilerThread *thread = profiler_thread;
+    if (Platform::atomic_load(&site->index, Platform::MEMORY_ORDER_RELAXED) == PROFILER_SITE_DROPPED) return;
+    if (thread && thread->dropped_depth > 0) {
+        thread->dropped_depth--;
+        return;
+    }
+
+    assert(thread && thread->depth > 0 && "end_zone without a matching begin_zone");
+
+    ProfilerOpenZone *zone = &thread->stack[--thread->depth];
+    assert(zone->site == site && "Profiler zones must end in the reverse order they began");
+
+    u64 elapsed                = end - zone->begin;
+    ProfilerSiteTotals *totals = &thread->totals[zone->index - 1];
+    totals->count++;
+    totals->exclusive += elapsed - zone->children;
+    if (--totals->active == 0) totals->inclusive += elapsed;
+    if (thread->depth > 0) thread->stack[thread->depth - 1].children += elapsed;
+
+    if (Platform::atomic_load(&profiler_logging, Platform::MEMORY_ORDER_RELAXED)) profiler_log_event(thread, zone->site, zone->begin, end);
+}
+
+static int compare_zone_stats(const void *a, const void *b) {
+    f64 lhs = ((const Bana::Profiler::ZoneStats *) a)->exclusive_ms;
+    f64 rhs = ((const Bana::Profiler::ZoneStats *) b)->exclusive_ms;
+    return lhs < rhs ? 1 : lhs > rhs ? -1 : 0;
+}
+
+Bana::Array<Bana::Profiler::ZoneStats> Bana::Profiler::collect_zone_stats(Allocator allocator) {
+    u32 site_count        = Platform::atomic_load(&profiler_site_count, Platform::MEMORY_ORDER_ACQUIRE);
+    Array<ZoneStats> ret  = make_array<ZoneStats>(site_count ? site_count : 1, allocator);
+    f64 ms_per_tick       = 1000.0 / cpu_timer_frequency();
+    ProfilerThread *first = Platform::atomic_load(&profiler_threads, Platform::MEMORY_ORDER_ACQUIRE);
+
+    for (u32 slot = 0; slot < site_count; ++slot) {
+        ZoneSite *site = Platform::atomic_load(&profiler_sites[slot], Platform::MEMORY_ORDER_ACQUIRE);
+        if (!site) continue;
+
+        ZoneStats stats = { site->name, site->file, site->line, 0, 0.0, 0.0 };
+        for (ProfilerThread *thread = first; thread; thread = thread->next) {
+            stats.count        += thread->totals[slot].count;
+            stats.inclusive_ms += thread->totals[slot].inclusive * ms_per_tick;
+            stats.exclusive_ms += thread->totals[slot].exclusive * ms_per_tick;
+        }
+
+        if (stats.count) ret.append(stats);
+    }
+
+    std::qsort(ret.data, ret.size, sizeof(ZoneStats), compare_zone_stats);
+    return ret;
+}
+
+void Bana::Profiler::print_zone_stats() {
+    ScratchMemory scratch;
+    Array<ZoneStats> stats = collect_zone_stats(scratch.allocator());
+
+    f64 total_ms = 0.0;
+    for (isize i = 0; i < stats.size; ++i) total_ms += stats[i].exclusive_ms;
+
+    std::printf("%-32s %12s %14s %14s %7s\n", "zone", "count", "inclusive ms", "exclusive ms", "excl %");
+    for (isize i = 0; i < stats.size; ++i) {
+        const ZoneStats &zone = stats[i];
+        std::printf("%-32s %12llu %14.3f %14.3f %6.2f%%  (%s:%d)\n", zone.name, (unsigned long long) zone.count, zone.inclusive_ms, zone.exclusive_ms,
+                    total_ms > 0.0 ? zone.exclusive_ms / total_ms * 100.0 : 0.0, zone.file, zone.line);
+    }
+}
+
+// Zone names are usually identifiers, but __func__ and string literals can hold anything.
+static bool write_json_string(Bana::Platform::FileWriter *writer, const char *str) {
+    char buffer[256];
+    usize used = 0;
+
+    buffer[used++] = '"';
+    for (; *str; ++str) {
+        if (used + 8 > sizeof(buffer)) {
+            if (!writer->write(buffer, used)) return false;
+            used = 0;
+        }
+
+        u8 c = (u8) *str;
+        if (c == '"' || c == '\\') {
+            buffer[used++] = '\\';
+            buffer[used++] = c;
+        } else if (c < 0x20) {
+            used += std::snprintf(buffer + used, sizeof(buffer) - used, "\\u%04x", c);
+        } else {
+            buffer[used++] = c;
+        }
+    }
+    buffer[used++] = '"';
+
+    return writer->write(buffer, used);
+}
+
+bool Bana::Profiler::export_chrome_trace(const String path) {
+    Platform::File *file = Platform::open_file_write(path);
+    if (!file) {
+        ICHIGO_ERROR("Failed to open %.*s for the profiler trace", (int) path.length, path.data);
+        return false;
+    }
+
+    Platform::FileWriter writer = Platform::make_file_writer(file, KILOBYTES(256));
+    f64 us_per_tick             = 1000000.0 / cpu_timer_frequency();
+    u64 epoch                   = Platform::atomic_load(&profiler_epoch, Platform::MEMORY_ORDER_RELAXED);
+    bool first_event            = true;
+    char buffer[256];
+
+    writer.write("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (ProfilerThread *thread = Platform::atomic_load(&profiler_threads, Platform::MEMORY_ORDER_ACQUIRE); thread; thread = thread->next) {
+        i32 length = std::snprintf(buffer, sizeof(buffer), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+                                   first_event ? "" : ",\n", thread->id, thread->id);
+        writer.write(buffer, length);
+        first_event = false;
+
+        for (ProfilerBlock *block = Platform::atomic_load(&thread->first, Platform::MEMORY_ORDER_ACQUIRE); block; block = Platform::atomic_load(&block->next, Platform::MEMORY_ORDER_ACQUIRE)) {
+            u32 count = Platform::atomic_load(&block->count, Platform::MEMORY_ORDER_ACQUIRE);
+            for (u32 i = 0; i < count; ++i) {
+                const ProfilerEvent &event = block->events[i];
+                writer.write(",\n{\"name\":");
+                write_json_string(&writer, event.site->name);
+                length = std::snprintf(buffer, sizeof(buffer), ",\"cat\":\"bana\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", thread->id,
+                                       (event.begin - epoch) * us_per_tick, (event.end - event.begin) * us_per_tick);
+                writer.write(buffer, length);
+            }
+        }
+    }
+    writer.write("\n]}\n");
+
+    bool ret = Platform::free_file_writer(&writer);
+    Platform::close_file(file);
+    if (!ret) ICHIGO_ERROR("Failed to write the profiler trace to %.*s", (int) path.length, path.data);
+    return ret;
+}
+
+void Bana::Profiler::set_event_logging(bool enabled) {
+    Platform::atomic_store(&profiler_logging, enabled, Platform::MEMORY_ORDER_RELAXED);
+}
+
+void Bana::Profiler::reset_profiler() {
+    for (ProfilerThread *thread = Platform::atomic_load(&profiler_threads, Platform::MEMORY_ORDER_ACQUIRE); thread; thread = thread->next) {
+        profiler_free_blocks(thread->first);
+        thread->first = thread->last = nullptr;
+
+        for (u32 i = 0; i < PROFILER_MAX_SITES; ++i) {
+            thread->totals[i].count     = 0;
+            thread->totals[i].inclusive = 0;
+            thread->totals[i].exclusive = 0;
+        }
+    }
+}
+
+Bana::Profiler::ProfilerOverhead Bana::Profiler::measure_profiler_overhead(u32 iterations) {
+    static ZoneSite site = { "profiler_overhead", __FILE__, __LINE__, 0 };
+
+    // Enter the site once up front so registration is not part of the measurement.
+    ProfilerThread *thread = profiler_thread;
+    if (!thread) thread = profiler_register_thread();
+    ProfilerBlock *saved_last = thread->last;
+    u32 saved_count           = saved_last ? saved_last->count : 0;
+    begin_zone(&site);
+    end_zone(&site);
+
+    f64 start_time = Platform::get_current_time();
+    u64 start      = read_cpu_timer();
+    for (u32 i = 0; i < iterations; ++i) {
+        begin_zone(&site);
+        end_zone(&site);
+    }
+    u64 cycles     = read_cpu_timer() - start;
+    f64 elapsed    = Platform::get_current_time() - start_time;
+
+    // Take the measurement back out of the log and the totals.
+    if (saved_last) {
+        profiler_free_blocks(saved_last->next);
+        saved_last->next  = nullptr;
+        saved_last->count = saved_count;
+    } else {
+        profiler_free_blocks(thread->first);
+        thread->first = nullptr;
+    }
+    thread->last = saved_last;
+    if (site.index != PROFILER_SITE_DROPPED) thread->totals[site.index - 1] = {};
+
+    ProfilerOverhead ret = {};
+    if (iterations) {
+        ret.cycles_per_zone = (f64) cycles / iterations;
+        ret.ns_per_zone     = elapsed * 1000000000.0 / iterations;
+    }
+
+    return ret;
+}
@@ -2,28 +2,902 @@
 
 #include "bana.hpp"
 
-#define BEGIN_TIMED_BLOCK(NAME) f64 NAME##_TIMED_BLOCK = Bana::Platform::get_current_time()
-#define END_TIMED_BLOCK(NAME)   ICHIGO_INFO("Timed block \"" #NAME "\" took %fms!", (Bana::Platform::get_current_time() - NAME##_TIMED_BLOCK) * 1000.0)
+#ifdef _MSC_VER
+#include <atomic>
+#endif
 
 namespace Bana {
 namespace Platform {
 struct File;
+struct Thread;
+struct Mutex;
+struct Semaphore;
+
+// Runs on a new thread. The thread's scratch arenas are released when it returns.
+using ThreadProc = void (void *userdata);
+
+enum ReadAheadHint {
+    READ_AHEAD_NORMAL,
+    READ_AHEAD_SEQUENTIAL, // Aggressive read-ahead, pages behind the access point may be dropped early.
+    READ_AHEAD_RANDOM,     // No read-ahead.
+    READ_AHEAD_WILLNEED,   // Start paging the whole file in immediately.
+};
+
+// A read-only view of a file's contents. The memory belongs to the OS, so it must be released with unmap_file().
+struct MappedFile {
+    u8 *data;
+    usize size;
+
+    inline Bana::BufferReader reader() const {
+        return { (char *) data, size, 0 };
+    }
+};
 
 File *open_file_write(const String path);
 void write_entire_file_sync(const char *path, const u8 *data, usize data_size);
 
 // Append to an open file. Generally works like fwrite() from the CRT.
 void append_file_sync(File *file, const u8 *data, usize data_size);
+// Write every segment in order with as few calls as possible, writev() style. Returns false on error.
+bool write_file_gather(File *file, const Bana::String *segments, isize count);
+// Block until everything written so far is on stable storage.
+bool sync_file(File *file);
 void close_file(File *file);
 Bana::Optional<Bana::FixedArray<u8>> read_entire_file_sync(const Bana::String path, Bana::Allocator allocator = Bana::heap_allocator);
 
+Bana::Optional<MappedFile> map_file(const Bana::String path, ReadAheadHint hint = READ_AHEAD_SEQUENTIAL);
+void unmap_file(MappedFile *file);
+
+Thread *create_thread(ThreadProc *proc, void *userdata);
+// Wait for the thread to finish and release it.
+void join_thread(Thread *thread);
+// Logical processors available to this process.
+u32 processor_count();
+
 bool file_exists(const char *path);
 void sleep(f64 t);
 f64 get_current_time();
 
+#ifdef _WIN32
 wchar_t *win32_to_wide_char(const Bana::String &str, Bana::Allocator allocator = Bana::heap_allocator);
 Bana::String win32_from_wide_char(const wchar_t *str, Bana::Allocator allocator = Bana::heap_allocator);
+#endif
 
 void init();
+
+// Thin wrappers over the compiler's atomic builtins so that the memory ordering is always spelled out at the call site.
+// MSVC has no such builtins, so there they go through std::atomic_ref instead.
+#ifdef _MSC_VER
+enum MemoryOrder {
+    MEMORY_ORDER_RELAXED = (int) std::memory_order_relaxed,
+    MEMORY_ORDER_ACQUIRE = (int) std::memory_order_acquire,
+    MEMORY_ORDER_RELEASE = (int) std::memory_order_release,
+    MEMORY_ORDER_ACQ_REL = (int) std::memory_order_acq_rel,
+    MEMORY_ORDER_SEQ_CST = (int) std::memory_order_seq_cst,
+};
+
+template<typename T>
+inline T atomic_load(const T *p, MemoryOrder order = MEMORY_ORDER_SEQ_CST) {
+    return std::atomic_ref<T>(*const_cast<T *>(p)).load((std::memory_order) order);
+}
+
+template<typename T>
+inline void atomic_store(T *p, T value, MemoryOrder order = MEMORY_ORDER_SEQ_CST) {
+    std::atomic_ref<T>(*p).store(value, (std::memory_order) order);
+}
+
+template<typename T>
+inline T atomic_exchange(T *p, T value, MemoryOrder order = MEMORY_ORDER_SEQ_CST) {
+    return std::atomic_ref<T>(*p).exchange(value, (std::memory_order) order);
+}
+
+// Both return the value from before the operation.
+template<typename T>
+inline T atomic_fetch_add(T *p, T value, MemoryOrder order = MEMORY_ORDER_SEQ_CST) {
+    return std::atomic_ref<T>(*p).fetch_add(value, (std::memory_order) order);
+}
+
+template<typename T>
+inline T atomic_fetch_sub(T *p, T value, MemoryOrder order = MEMORY_ORDER_SEQ_CST) {
+    return std::atomic_ref<T>(*p).fetch_sub(value, (std::memory_order) order);
+}
+
+// On failure, expected is updated to the current value.
+template<typename T>
+inline bool atomic_compare_exchange(T *p, T *expected, T desired, MemoryOrder success = MEMORY_ORDER_SEQ_CST, MemoryOrder failure = MEMORY_ORDER_SEQ_CST) {
+    return std::atomic_ref<T>(*p).compare_exchange_strong(*expected, desired, (std::memory_order) success, (std::memory_order) failure);
+}
+
+inline void atomic_fence(MemoryOrder order = MEMORY_ORDER_SEQ_CST) {
+    std::atomic_thread_fence((std::memory_order) order);
+}
+
+// Spin-wait hint to the CPU.
+inline void cpu_relax() {
+#if defined(_M_X64) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(_M_ARM64)
+    __yield();
+#endif
+}
+#else
+enum MemoryOrder {
+    MEMORY_ORDER_RELAXED = __ATOMIC_RELAXED,
+    MEMORY_ORDER_ACQUIRE = __ATOMIC_ACQUIRE,
+    MEMORY_ORDER_RELEASE = __ATOMIC_RELEASE,
+    MEMORY_ORDER_ACQ_REL = __ATOMIC_ACQ_REL,
+    MEMORY_ORDER_SEQ_CST = __ATOMIC_SEQ_CST,
+};
+
+template<typename T>
+inline T atomic_load(const T *p, MemoryOrder order = MEMORY_ORDER_SEQ_CST) {
+    return __atomic_load_n(p, order);
+}
+
+template<typename T>
+inline void atomic_store(T *p, T value, MemoryOrder order = MEMORY_ORDER_SEQ_CST) {
+    __atomic_store_n(p, value, order);
+}
+
+template<typename T>
+inline T atomic_exchange(T *p, T value, MemoryOrder order = MEMORY_ORDER_SEQ_CST) {
+    return __atomic_exchange_n(p, value, order);
+}
+
+// Both return the value from before the operation.
+template<typename T>
+inline T atomic_fetch_add(T *p, T value, MemoryOrder order = MEMORY_ORDER_SEQ_CST) {
+    return __atomic_fetch_add(p, value, order);
+}
+
+template<typename T>
+inline T atomic_fetch_sub(T *p, T value, MemoryOrder order = MEMORY_ORDER_SEQ_CST) {
+    return __atomic_fetch_sub(p, value, order);
+}
+
+// On failure, expected is updated to the current value.
+template<typename T>
+inline bool atomic_compare_exchange(T *p, T *expected, T desired, MemoryOrder success = MEMORY_ORDER_SEQ_CST, MemoryOrder failure = MEMORY_ORDER_SEQ_CST) {
+    return __atomic_compare_exchange_n(p, expected, desired, false, success, failure);
+}
+
+inline void atomic_fence(MemoryOrder order = MEMORY_ORDER_SEQ_CST) {
+    __atomic_thread_fence(order);
+}
+
+// Spin-wait hint to the CPU.
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+#endif
+
+// Give up the rest of the calling thread's time slice.
+void yield_thread();
+
+// Sleep while *address == expected. Can return spuriously, so callers loop on their own condition.
+void futex_wait(u32 *address, u32 expected);
+void futex_wake_one(u32 *address);
+void futex_wake_all(u32 *address);
+
+// Lets threads sleep until some condition changes without a lock around the condition. A waiter takes a key, checks the
+// condition once more and only then sleeps; a notify after the condition changes bumps the epoch so that a waiter that
+// took its key before the change never sleeps on it. Notifying is just a fence and a load while nobody is waiting.
+struct EventCount {
+    u32 epoch;
+    u32 waiters;
+
+    inline u32 prepare_wait() {
+        atomic_fetch_add(&waiters, 1u);
+        atomic_fence(MEMORY_ORDER_SEQ_CST);
+        return atomic_load(&epoch, MEMORY_ORDER_ACQUIRE);
+    }
+
+    inline void cancel_wait() {
+        atomic_fetch_sub(&waiters, 1u);
+    }
+
+    inline void wait(u32 key) {
+        futex_wait(&epoch, key);
+        atomic_fetch_sub(&waiters, 1u);
+    }
+
+    inline void notify_all() {
+        atomic_fence(MEMORY_ORDER_SEQ_CST);
+        if (atomic_load(&waiters, MEMORY_ORDER_RELAXED) == 0) return;
+
+        atomic_fetch_add(&epoch, 1u, MEMORY_ORDER_RELEASE);
+        futex_wake_all(&epoch);
+    }
+};
+
+Mutex *create_mutex();
+void destroy_mutex(Mutex *mutex);
+void lock_mutex(Mutex *mutex);
+void unlock_mutex(Mutex *mutex);
+
+Semaphore *create_semaphore(u32 initial_count = 0);
+void destroy_semaphore(Semaphore *semaphore);
+void signal_semaphore(Semaphore *semaphore, u32 count = 1);
+void wait_semaphore(Semaphore *semaphore);
+
+// Bounded lock-free queues. Capacities are rounded up to a power of two. Queues made with blocking set also get push()
+// and pop() which sleep on a futex while the queue is full or empty, at the cost of a fence per operation to check for
+// sleepers. Do not copy a queue once threads share it.
+inline usize queue_capacity_for(usize capacity) {
+    usize ret = 2;
+    while (ret < capacity) ret *= 2;
+    return ret;
+}
+
+// Single producer, single consumer ring. Each side keeps its index and a cached copy of the other side's index on its own
+// cache line, so in the steady state neither side touches the other's line until the cached copy runs out.
+template<typename T>
+struct SpscQueue {
+    // Consumer side.
+    alignas(CACHE_LINE_SIZE) usize head;
+    usize cached_tail;
+
+    // Producer side.
+    alignas(CACHE_LINE_SIZE) usize tail;
+    usize cached_head;
+
+    alignas(CACHE_LINE_SIZE) T *slots;
+    usize mask;
+    bool blocking;
+    Allocator allocator;
+    EventCount event;
+
+    // Push as many of items as fit. Returns the count pushed.
+    isize try_push_batch(const T *items, isize count) {
+        if (count <= 0) return 0;
+
+        usize t    = atomic_load(&tail, MEMORY_ORDER_RELAXED);
+        usize room = mask + 1 - (t - cached_head);
+        if (room < (usize) count) {
+            cached_head = atomic_load(&head, MEMORY_ORDER_ACQUIRE);
+            room        = mask + 1 - (t - cached_head);
+        }
+
+        isize n = MIN((usize) count, room);
+        for (isize i = 0; i < n; ++i) slots[(t + i) & mask] = items[i];
+
+        if (n > 0) {
+            atomic_store(&tail, t + n, MEMORY_ORDER_RELEASE);
+            if (blocking) event.notify_all();
+        }
+
+        return n;
+    }
+
+    // Pop up to max items. Returns the count popped.
+    isize try_pop_batch(T *items, isize max) {
+        if (max <= 0) return 0;
+
+        usize h         = atomic_load(&head, MEMORY_ORDER_RELAXED);
+        usize available = cached_tail - h;
+        if (available < (usize) max) {
+            cached_tail = atomic_load(&tail, MEMORY_ORDER_ACQUIRE);
+            available   = cached_tail - h;
+        }
+
+        isize n = MIN((usize) max, available);
+        for (isize i = 0; i < n; ++i) items[i] = slots[(h + i) & mask];
+
+        if (n > 0) {
+            atomic_store(&head, h + n, MEMORY_ORDER_RELEASE);
+            if (blocking) event.notify_all();
+        }
+
+        return n;
+    }
+
+    inline bool try_push(const T &item) {
+        return try_push_batch(&item, 1) == 1;
+    }
+
+    inline bool try_pop(T *item) {
+        return try_pop_batch(item, 1) == 1;
+    }
+
+    void push_batch(const T *items, isize count) {
+        assert(blocking);
+        if (count <= 0) return;
+
+        for (;;) {
+            isize n  = try_push_batch(items, count);
+            items   += n;
+            count   -= n;
+            if (count == 0) return;
+
+            u32 key = event.prepare_wait();
+            n       = try_push_batch(items, count);
+            items  += n;
+            count  -= n;
+
+            if (n > 0) event.cancel_wait();
+            else       event.wait(key);
+
+            if (count == 0) return;
+        }
+    }
+
+    // Blocks until at least one item is available.
+    isize pop_batch(T *items, isize max) {
+        assert(blocking);
+        if (max <= 0) return 0;
+
+        for (;;) {
+            isize n = try_pop_batch(items, max);
+            if (n > 0) return n;
+
+            u32 key = event.prepare_wait();
+            n       = try_pop_batch(items, max);
+            if (n > 0) {
+                event.cancel_wait();
+                return n;
+            }
+
+            event.wait(key);
+        }
+    }
+
+    inline void push(const T &item) {
+        push_batch(&item, 1);
+    }
+
+    inline T pop() {
+        T ret;
+        pop_batch(&ret, 1);
+        return ret;
+    }
+
+    inline usize size_approx() const {
+        return atomic_load(&tail, MEMORY_ORDER_RELAXED) - atomic_load(&head, MEMORY_ORDER_RELAXED);
+    }
+};
+
+template<typename T>
+SpscQueue<T> make_spsc_queue(usize capacity, bool blocking = false, Allocator allocator = heap_allocator) {
+    SpscQueue<T> ret = {};
+    usize size       = queue_capacity_for(capacity);
+
+    ret.slots     = (T *) allocator.alloc(size * sizeof(T));
+    ret.mask      = size - 1;
+    ret.blocking  = blocking;
+    ret.allocator = allocator;
+
+    return ret;
+}
+
+template<typename T>
+void free_spsc_queue(SpscQueue<T> *queue) {
+    queue->allocator.free(queue->slots);
+    queue->slots = nullptr;
+}
+
+// Multi producer, multi consumer queue after Dmitry Vyukov's bounded MPMC queue. Every cell carries a sequence number
+// that says whose turn it is: a producer at position p waits for sequence p and publishes p + 1, and the consumer at p
+// waits for p + 1 and hands the cell back with p + capacity. Producers and consumers only contend on their own cursor.
+template<typename T>
+struct MpmcCell {
+    usize sequence;
+    T item;
+};
+
+template<typename T>
+struct MpmcQueue {
+    alignas(CACHE_LINE_SIZE) usize enqueue_pos;
+    alignas(CACHE_LINE_SIZE) usize dequeue_pos;
+
+    alignas(CACHE_LINE_SIZE) MpmcCell<T> *cells;
+    usize mask;
+    bool blocking;
+    Allocator allocator;
+    EventCount event;
+
+    // Batches claim the longest run of ready cells from the cursor with a single CAS. Cells in that run can only change
+    // hands through the cursor, so they stay ready until we fill or drain them.
+    isize try_push_batch(const T *items, isize count) {
+        if (count <= 0) return 0;
+
+        usize pos = atomic_load(&enqueue_pos, MEMORY_ORDER_RELAXED);
+        isize n   = 0;
+
+        for (;;) {
+            n = 0;
+            while (n < count && atomic_load(&cells[(pos + n) & mask].sequence, MEMORY_ORDER_ACQUIRE) == pos + n) ++n;
+
+            if (n == 0) {
+                usize sequence = atomic_load(&cells[pos & mask].sequence, MEMORY_ORDER_ACQUIRE);
+                if ((isize) (sequence - pos) < 0) return 0; // Full.
+
+                // Another producer got here first.
+                pos = atomic_load(&enqueue_pos, MEMORY_ORDER_RELAXED);
+                continue;
+            }
+
+            if (atomic_compare_exchange(&enqueue_pos, &pos, pos + n, MEMORY_ORDER_RELAXED, MEMORY_ORDER_RELAXED)) break;
+        }
+
+        for (isize i = 0; i < n; ++i) {
+            MpmcCell<T> *cell = &cells[(pos + i) & mask];
+            cell->item        = items[i];
+            atomic_store(&cell->sequence, pos + i + 1, MEMORY_ORDER_RELEASE);
+        }
+
+        if (blocking) event.notify_all();
+        return n;
+    }
+
+    isize try_pop_batch(T *items, isize max) {
+        if (max <= 0) return 0;
+
+        usize pos = atomic_load(&dequeue_pos, MEMORY_ORDER_RELAXED);
+        isize n   = 0;
+
+        for (;;) {
+            n = 0;
+            while (n < max && atomic_load(&cells[(pos + n) & mask].sequence, MEMORY_ORDER_ACQUIRE) == pos + n + 1) ++n;
+
+            if (n == 0) {
+                usize sequence = atomic_load(&cells[pos & mask].sequence, MEMORY_ORDER_ACQUIRE);
+                if ((isize) (sequence - (pos + 1)) < 0) return 0; // Empty.
+
+                pos = atomic_load(&dequeue_pos, MEMORY_ORDER_RELAXED);
+                continue;
+            }
+
+            if (atomic_compare_exchange(&dequeue_pos, &pos, pos + n, MEMORY_ORDER_RELAXED, MEMORY_ORDER_RELAXED)) break;
+        }
+
+        for (isize i = 0; i < n; ++i) {
+            MpmcCell<T> *cell = &cells[(pos + i) & mask];
+            items[i]          = cell->item;
+            atomic_store(&cell->sequence, pos + i + mask + 1, MEMORY_ORDER_RELEASE);
+        }
+
+        if (blocking) event.notify_all();
+        return n;
+    }
+
+    inline bool try_push(const T &item) {
+        return try_push_batch(&item, 1) == 1;
+    }
+
+    inline bool try_pop(T *item) {
+        return try_pop_batch(item, 1) == 1;
+    }
+
+    void push_batch(const T *items, isize count) {
+        assert(blocking);
+        if (count <= 0) return;
+
+        for (;;) {
+            isize n  = try_push_batch(items, count);
+            items   += n;
+            count   -= n;
+            if (count == 0) return;
+
+            u32 key = event.prepare_wait();
+            n       = try_push_batch(items, count);
+            items  += n;
+            count  -= n;
+
+            if (n > 0) event.cancel_wait();
+            else       event.wait(key);
+
+            if (count == 0) return;
+        }
+    }
+
+    // Blocks until at least one item is available.
+    isize pop_batch(T *items, isize max) {
+        assert(blocking);
+        if (max <= 0) return 0;
+
+        for (;;) {
+            isize n = try_pop_batch(items, max);
+            if (n > 0) return n;
+
+            u32 key = event.prepare_wait();
+            n       = try_pop_batch(items, max);
+            if (n > 0) {
+                event.cancel_wait();
+                return n;
+            }
+
+            event.wait(key);
+        }
+    }
+
+    inline void push(const T &item) {
+        push_batch(&item, 1);
+    }
+
+    inline T pop() {
+        T ret;
+        pop_batch(&ret, 1);
+        return ret;
+    }
+
+    inline usize size_approx() const {
+        usize enqueued = atomic_load(&enqueue_pos, MEMORY_ORDER_RELAXED);
+        usize dequeued = atomic_load(&dequeue_pos, MEMORY_ORDER_RELAXED);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+};
+
+template<typename T>
+MpmcQueue<T> make_mpmc_queue(usize capacity, bool blocking = false, Allocator allocator = heap_allocator) {
+    MpmcQueue<T> ret = {};
+    usize size       = queue_capacity_for(capacity);
+
+    ret.cells     = (MpmcCell<T> *) allocator.alloc(size * sizeof(MpmcCell<T>));
+    ret.mask      = size - 1;
+    ret.blocking  = blocking;
+    ret.allocator = allocator;
+
+    for (usize i = 0; i < size; ++i) ret.cells[i].sequence = i;
+
+    return ret;
+}
+
+template<typename T>
+void free_mpmc_queue(MpmcQueue<T> *queue) {
+    queue->allocator.free(queue->cells);
+    queue->cells = nullptr;
+}
+
+// Work stealing job system. Every worker owns a Chase-Lev deque: it pushes and pops jobs at the bottom while idle
+// workers steal from the top of someone else's. Jobs submitted from threads that are not workers go through a shared
+// queue instead. The thread that calls init_job_system() becomes worker 0, but only runs jobs while it waits.
+//
+// Workers are ordinary platform threads, so each has its own scratch arenas. Jobs can use ScratchMemory freely, but
+// nothing allocated from it survives the job.
+#define JOB_DEQUE_CAPACITY 4096
+
+using JobProc   = void (void *userdata);
+using RangeProc = void (isize begin, isize end, void *userdata);
+
+struct JobContinuation;
+
+// Counts the jobs that still have to finish. Zero initialize it, hand it to the jobs, then wait on it. Jobs can also be
+// made to start only once a counter reaches zero with run_job_after().
+struct JobCounter {
+    i64 pending;
+    bool locked;
+    JobContinuation *continuations;
+};
+
+struct Job {
+    JobProc *proc;
+    void *userdata;
+    JobCounter *counter;
+};
+
+// worker_count includes the calling thread. 0 uses one worker per processor.
+void init_job_system(u32 worker_count = 0);
+// Waits for the workers to exit. Jobs still queued are dropped.
+void shutdown_job_system();
+bool job_system_running();
+u32 job_worker_count();
+// Index of the calling worker, or -1 on threads outside the job system.
+i32 job_worker_index();
+
+void run_job(JobProc *proc, void *userdata, JobCounter *counter = nullptr);
+void run_jobs(const Job *jobs, isize count);
+// Queue the job once dependency reaches zero. counter counts it as pending right away.
+void run_job_after(JobCounter *dependency, JobProc *proc, void *userdata, JobCounter *counter = nullptr);
+// Run queued jobs until counter reaches zero, so waiting inside a job never deadlocks the pool.
+void wait_for_counter(JobCounter *counter);
+
+// Call proc over [begin, end) split into ranges of at most grain indices, and return once they are all done. Workers
+// claim ranges from a shared cursor, so uneven ranges balance out. A grain of 0 picks one that gives every worker
+// several ranges.
+void parallel_for(isize begin, isize end, isize grain, RangeProc *proc, void *userdata);
+}
+
+namespace Platform {
+// Asynchronous file I/O. Reads and writes are queued with submit_read()/submit_write(), handed to the OS in one batch
+// by submit_async_io(), and their callbacks run on whichever thread calls poll_async_io(). On Linux this sits on
+// io_uring, falling back to a small pool of threads doing pread()/pwrite() when io_uring is unavailable. On Windows it
+// uses overlapped I/O and a completion port. An AsyncIo belongs to one thread; use one per thread that does I/O.
+#define ASYNC_IO_DIRECT_ALIGNMENT 4096
+#define ASYNC_IO_POOL_THREADS     4
+
+struct AsyncIo;
+struct AsyncFile;
+
+enum AsyncFileFlags {
+    ASYNC_FILE_READ   = 1 << 0,
+    ASYNC_FILE_WRITE  = 1 << 1,
+    ASYNC_FILE_CREATE = 1 << 2, // Create the file, or truncate it if it exists.
+    // Bypass the page cache. Buffers, sizes and offsets must all be multiples of ASYNC_IO_DIRECT_ALIGNMENT.
+    ASYNC_FILE_DIRECT = 1 << 3,
+};
+
+enum AsyncIoFlags {
+    ASYNC_IO_FORCE_THREAD_POOL = 1 << 0,
+};
+
+struct AsyncCompletion {
+    void *userdata;
+    void *buffer;
+    usize size;
+    u64 offset;
+    // Bytes transferred, which can be short like pread()/pwrite(), or a negative error code.
+    i64 result;
+};
+
+using AsyncIoProc = void (const AsyncCompletion *completion);
+
+struct AsyncBuffer {
+    void *data;
+    usize size;
+};
+
+// queue_depth is how many requests can be waiting to be submitted at once. Twice that many can be in flight.
+AsyncIo *create_async_io(u32 queue_depth = 256, u32 flags = 0);
+// Waits for everything in flight first.
+void destroy_async_io(AsyncIo *io);
+bool async_io_uses_io_uring(const AsyncIo *io);
+u32 async_io_in_flight(const AsyncIo *io);
+
+AsyncFile *open_async_file(AsyncIo *io, const String path, u32 flags);
+void close_async_file(AsyncFile *file);
+Optional<u64> async_file_size(AsyncFile *file);
+
+// Pin buffers that will be used over and over so the kernel does not have to map them for every request. Reads and
+// writes that fall inside a registered buffer use it automatically. Replaces any earlier registration and can only be
+// done with nothing in flight. Only io_uring does anything with this.
+bool register_async_buffers(AsyncIo *io, const AsyncBuffer *buffers, u32 count);
+
+// Both return false when every request slot is in use. Poll for completions and try again. They also return false once
+// io_uring has failed for good, which is logged.
+bool submit_read(AsyncIo *io, AsyncFile *file, void *buffer, usize size, u64 offset, AsyncIoProc *callback, void *userdata);
+bool submit_write(AsyncIo *io, AsyncFile *file, const void *buffer, usize size, u64 offset, AsyncIoProc *callback, void *userdata);
+// Hand every queued request to the OS. Returns how many were submitted.
+u32 submit_async_io(AsyncIo *io);
+// Submit anything queued, then run the callbacks of finished requests, waiting until at least min_completions have
+// finished (or nothing is left in flight, or io_uring has failed). Returns the number of completions handled.
+u32 poll_async_io(AsyncIo *io, u32 min_completions = 0);
+}
+
+namespace Platform {
+// Buffered writer over an open File. Small writes are copied into the buffer. A write that does not fit goes out in one
+// gathered call together with whatever is already buffered, so large payloads are never copied. Errors are sticky: once
+// a write or sync fails, every later call fails too and failed stays set.
+enum WriterFlushPolicy {
+    WRITER_FLUSH_WHEN_FULL, // Only write when the buffer fills up or on an explicit flush().
+    WRITER_FLUSH_LINES,     // Also flush after every write that contains a newline.
+    WRITER_FLUSH_ALWAYS,    // Flush after every write. The segments of a single write still go out together.
+};
+
+enum WriterSyncPolicy {
+    WRITER_SYNC_NEVER,    // Leave it to the OS.
+    WRITER_SYNC_ON_CLOSE, // Sync once in free_file_writer().
+    WRITER_SYNC_ON_FLUSH, // Sync every time buffered data is handed to the OS.
+};
+
+struct FileWriter {
+    File *file;
+    u8 *buffer;
+    usize capacity;
+    usize used;
+    WriterFlushPolicy flush_policy;
+    WriterSyncPolicy sync_policy;
+    bool failed;
+    Allocator allocator;
+
+    bool write_segments(const String *segments, isize count);
+    bool flush();
+    // Flush, then wait for the data to reach stable storage regardless of sync_policy.
+    bool sync();
+
+    inline bool write(const void *data, usize size) {
+        String segment = { (char *) data, size, size };
+        return write_segments(&segment, 1);
+    }
+
+    inline bool write(const String &str) {
+        return write_segments(&str, 1);
+    }
+
+    inline bool write(const char *cstr) {
+        return write(cstr, std::strlen(cstr));
+    }
+
+    template<typename T>
+    inline bool write(const BufferBuilder<T> &builder) {
+        return write(builder.data, builder.size * sizeof(T));
+    }
+};
+
+FileWriter make_file_writer(File *file, usize buffer_size = KILOBYTES(64), WriterFlushPolicy flush_policy = WRITER_FLUSH_WHEN_FULL, WriterSyncPolicy sync_policy = WRITER_SYNC_NEVER, Allocator allocator = heap_allocator);
+// Flush what is left and sync if the policy asks for it. The file stays open. Returns false if anything ever failed.
+bool free_file_writer(FileWriter *writer);
+}
+
+// Parallel record scanning. The buffer is split into chunks that each end just past a record delimiter (the last chunk
+// ends wherever the buffer does), and every chunk is handed to a worker as its own BufferReader. Chunks never split a
+// record, so procs can parse them with the usual sequential BufferReader functions.
+#define SCAN_CHUNKS_PER_THREAD 4
+#define SCAN_MIN_CHUNK_SIZE    MEGABYTES(1)
+
+struct ScanOptions {
+    char delimiter;
+    // Delimiters between a pair of quote characters do not end a record. Doubled quotes ("") escape a quote in CSV
+    // without changing whether we are inside a field, so they need no special handling.
+    bool quote_aware;
+    char quote;
+    u32 thread_count; // 0 uses every processor. Also decides the chunk count when the job system runs the scan.
+    usize min_chunk_size;
+};
+
+inline ScanOptions make_scan_options(char delimiter = '\n', u32 thread_count = 0) {
+    ScanOptions ret    = {};
+    ret.delimiter      = delimiter;
+    ret.quote          = '"';
+    ret.thread_count   = thread_count;
+    ret.min_chunk_size = SCAN_MIN_CHUNK_SIZE;
+    return ret;
+}
+
+inline ScanOptions make_csv_scan_options(u32 thread_count = 0) {
+    ScanOptions ret = make_scan_options('\n', thread_count);
+    ret.quote_aware = true;
+    return ret;
+}
+
+using ScanProc = void (BufferReader *chunk, isize chunk_index, void *userdata);
+
+// The most chunks a scan of size bytes can be split into.
+isize scan_chunk_limit(usize size, const ScanOptions &options);
+// Split the unread part of buffer into at most max_chunks record aligned chunks. Returns the chunk count.
+isize split_records(const BufferReader &buffer, const ScanOptions &options, BufferReader *chunks, isize max_chunks);
+// Run proc over every chunk and return once all of them are done. Chunks go to the job system's workers when it is
+// running and to options.thread_count threads (the calling thread included) otherwise. Chunks are picked up in order but may finish in any order. Returns the chunk count.
+isize parallel_scan(const BufferReader &buffer, const ScanOptions &options, ScanProc *proc, void *userdata);
+
+template<typename Result>
+struct ScanCollectContext {
+    Result (*proc)(BufferReader *chunk, void *userdata);
+    void *userdata;
+    Result *results;
+};
+
+template<typename Result>
+void scan_collect_chunk(BufferReader *chunk, isize chunk_index, void *userdata) {
+    ScanCollectContext<Result> *context = (ScanCollectContext<Result> *) userdata;
+    context->results[chunk_index]       = context->proc(chunk, context->userdata);
+}
+
+// Like parallel_scan, but each chunk produces a result and the results come back in buffer order.
+template<typename Result>
+FixedArray<Result> parallel_scan_collect(const BufferReader &buffer, const ScanOptions &options, Result (*proc)(BufferReader *chunk, void *userdata), void *userdata, Allocator allocator = heap_allocator) {
+    FixedArray<Result> ret             = make_fixed_array<Result>(scan_chunk_limit(buffer.size - buffer.cursor, options), allocator);
+    ScanCollectContext<Result> context = { proc, userdata, ret.data };
+    ret.size                           = parallel_scan(buffer, options, scan_collect_chunk<Result>, &context);
+    return ret;
+}
+
+// Map every chunk to a Result in parallel, then fold the results into the first one in buffer order.
+template<typename Result>
+Result parallel_scan_reduce(const BufferReader &buffer, const ScanOptions &options, Result (*proc)(BufferReader *chunk, void *userdata), void (*merge)(Result *into, Result *chunk_result), void *userdata) {
+    ScratchMemory scratch;
+    FixedArray<Result> results = parallel_scan_collect(buffer, options, proc, userdata, scratch.allocator());
+    Result ret = {};
+    if (results.size == 0) return ret;
+
+    ret = results[0];
+    for (isize i = 1; i < results.size; ++i) merge(&ret, &results[i]);
+    return ret;
+}
+}
+
+// Hierarchical profiler. Zones are timed with the CPU timestamp counter and may nest. Every thread records into its own
+// buffers, so timing a zone takes no locks and touches no shared cache lines. Per zone totals (hit count, inclusive and
+// exclusive time) are kept as zones close. Completed zones are also logged as events for export to the Chrome trace
+// format, which chrome://tracing and ui.perfetto.dev can open.
+//
+// The macros compile to nothing unless BANA_PROFILE is defined. The functions below are always available, so tooling
+// code does not need its own ifdefs.
+#ifdef BANA_PROFILE
+#define PROFILE_CONCAT_(A, B) A##B
+#define PROFILE_CONCAT(A, B)  PROFILE_CONCAT_(A, B)
+#define PROFILE_ZONE(NAME)                                                                                  \
+    static Bana::Profiler::ZoneSite PROFILE_CONCAT(profile_site_, __LINE__) = { NAME, __FILE__, __LINE__, 0 }; \
+    Bana::Profiler::ScopedZone PROFILE_CONCAT(profile_zone_, __LINE__)(&PROFILE_CONCAT(profile_site_, __LINE__))
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+// Unscoped zones. Blocks must be ended in the reverse order they were begun, on the thread that began them.
+#define BEGIN_TIMED_BLOCK(NAME)                                                                \
+    static Bana::Profiler::ZoneSite NAME##_PROFILE_SITE = { #NAME, __FILE__, __LINE__, 0 }; \
+    Bana::Profiler::begin_zone(&NAME##_PROFILE_SITE)
+#define END_TIMED_BLOCK(NAME) Bana::Profiler::end_zone(&NAME##_PROFILE_SITE)
+#else
+#define PROFILE_ZONE(NAME)
+#define PROFILE_FUNCTION()
+#define BEGIN_TIMED_BLOCK(NAME)
+#define END_TIMED_BLOCK(NAME)
+#endif
+
+namespace Bana {
+namespace Profiler {
+#define PROFILER_MAX_SITES   1024
+#define PROFILER_MAX_DEPTH   256
+#define PROFILER_BLOCK_SIZE  4096 // Events per block. Blocks are chained as a thread's log grows.
+// Given to sites registered after all PROFILER_MAX_SITES slots are taken. Their zones are not recorded.
+#define PROFILER_SITE_DROPPED 0xFFFFFFFF
+
+// One per PROFILE_ZONE/BEGIN_TIMED_BLOCK in the source. The index is handed out the first time the zone is entered.
+struct ZoneSite {
+    const char *name;
+    const char *file;
+    i32 line;
+    u32 index; // 0 until registered, then the site's slot + 1, or PROFILER_SITE_DROPPED.
+};
+
+inline u64 read_cpu_timer() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__aarch64__)
+    u64 ret;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(ret));
+    return ret;
+#else
+    return (u64) (Platform::get_current_time() * 1000000000.0);
+#endif
+}
+
+// Ticks of read_cpu_timer() per second. Measured against the OS clock on first use, which takes about 10ms.
+f64 cpu_timer_frequency();
+
+void begin_zone(ZoneSite *site);
+void end_zone(ZoneSite *site);
+
+struct ScopedZone {
+    ZoneSite *site;
+
+    ScopedZone(ZoneSite *site) : site(site) { begin_zone(site); }
+    ~ScopedZone() { end_zone(site); }
+};
+
+struct ZoneStats {
+    const char *name;
+    const char *file;
+    i32 line;
+    u64 count;
+    // Time spent from entering to leaving the zone. Recursive entries are only counted at the outermost level.
+    f64 inclusive_ms;
+    // Inclusive time minus the time spent in zones nested directly inside it.
+    f64 exclusive_ms;
+};
+
+// Per zone totals summed over every thread, sorted by exclusive time, highest first.
+// Like the other readers below, this expects the profiled threads to be quiet (not inside a zone) while it runs.
+Array<ZoneStats> collect_zone_stats(Allocator allocator = heap_allocator);
+// Print collect_zone_stats() as a table.
+void print_zone_stats();
+// Write every logged event to path as Chrome trace event JSON. Returns false if the file could not be written.
+bool export_chrome_trace(const String path);
+// Event logging can be turned off to keep only the totals, e.g. for long runs. On by default.
+void set_event_logging(bool enabled);
+// Drop every logged event and zero the totals. Registered sites keep their indices.
+void reset_profiler();
+
+struct ProfilerOverhead {
+    f64 cycles_per_zone;
+    f64 ns_per_zone;
+};
+
+// Time iterations empty zones on the calling thread and return the average cost of one. The measurement zones are
+// removed from the totals and the event log afterwards.
+ProfilerOverhead measure_profiler_overhead(u32 iterations = 100000);
 }
 }
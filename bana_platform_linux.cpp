@@ -0,0 +1,836 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "bana_platform.hpp"
+
+// Files at least this large are read through a sequential mapping instead of read().
+#define LINUX_MMAP_READ_THRESHOLD MEGABYTES(1)
+
+struct Bana::Platform::File {
+    i32 fd;
+};
+
+// Open files live in a free list that grows a slab at a time, so there is no limit on how many can be open and a File
+// pointer stays valid until it is closed.
+#define LINUX_FILE_TABLE_SLAB 64
+#define LINUX_GATHER_BATCH    64
+
+static Bana::FreeList file_table;
+static pthread_mutex_t file_table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+struct Bana::Platform::Thread {
+    pthread_t handle;
+    ThreadProc *proc;
+    void *userdata;
+};
+
+struct Bana::Platform::Mutex {
+    pthread_mutex_t handle;
+};
+
+struct Bana::Platform::Semaphore {
+    sem_t handle;
+};
+
+static char *linux_to_cstr(const Bana::String &str, Bana::Allocator allocator = Bana::heap_allocator) {
+    char *cstr = (char *) allocator.alloc(str.length + 1);
+    std::memcpy(cstr, str.data, str.length);
+    cstr[str.length] = '\0';
+    return cstr;
+}
+
+static bool linux_write_all(i32 fd, const u8 *data, usize data_size) {
+    while (data_size > 0) {
+        isize written = write(fd, data, data_size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        data      += written;
+        data_size -= written;
+    }
+
+    return true;
+}
+
+static bool linux_read_all(i32 fd, u8 *data, usize data_size) {
+    while (data_size > 0) {
+        isize bytes_read = read(fd, data, data_size);
+        if (bytes_read < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        // The file shrunk underneath us.
+        if (bytes_read == 0) return false;
+
+        data      += bytes_read;
+        data_size -= bytes_read;
+    }
+
+    return true;
+}
+
+Bana::Platform::File *Bana::Platform::open_file_write(const Bana::String path) {
+    Bana::ScratchMemory scratch;
+    char *cpath = linux_to_cstr(path, scratch.allocator());
+    i32 fd = open(cpath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd < 0) {
+        ICHIGO_ERROR("Failed to open file for writing!");
+        return nullptr;
+    }
+
+    pthread_mutex_lock(&file_table_lock);
+    File *file = (File *) file_table.alloc(sizeof(File));
+    pthread_mutex_unlock(&file_table_lock);
+
+    file->fd = fd;
+    return file;
+}
+
+void Bana::Platform::write_entire_file_sync(const char *path, const u8 *data, usize data_size) {
+    i32 fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd < 0) {
+        ICHIGO_ERROR("Failed to open file for writing!");
+        return;
+    }
+
+    if (!linux_write_all(fd, data, data_size)) {
+        ICHIGO_ERROR("Failed to write file!");
+    }
+
+    close(fd);
+}
+
+void Bana::Platform::append_file_sync(File *file, const u8 *data, usize data_size) {
+    if (!linux_write_all(file->fd, data, data_size)) {
+        ICHIGO_ERROR("Failed to write to file!");
+    }
+}
+
+bool Bana::Platform::write_file_gather(File *file, const Bana::String *segments, isize count) {
+    iovec iovecs[LINUX_GATHER_BATCH];
+    isize next = 0;
+    usize skip = 0; // Bytes of segments[next] that are already written.
+
+    while (next < count) {
+        i32 iovec_count = 0;
+        for (isize i = next; i < count && iovec_count < LINUX_GATHER_BATCH; ++i) {
+            usize offset = i == next ? skip : 0;
+            if (segments[i].length == offset) continue;
+            iovecs[iovec_count++] = { segments[i].data + offset, segments[i].length - offset };
+        }
+
+        if (iovec_count == 0) return true;
+
+        isize written = writev(file->fd, iovecs, iovec_count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            ICHIGO_ERROR("Failed to write to file!");
+            return false;
+        }
+
+        // Partial writes stop anywhere, including in the middle of a segment.
+        while (next < count && (usize) written >= segments[next].length - skip) {
+            written -= segments[next].length - skip;
+            skip     = 0;
+            ++next;
+        }
+
+        skip += written;
+    }
+
+    return true;
+}
+
+bool Bana::Platform::sync_file(File *file) {
+    while (fdatasync(file->fd) != 0) {
+        if (errno == EINTR) continue;
+        ICHIGO_ERROR("Failed to sync file!");
+        return false;
+    }
+
+    return true;
+}
+
+void Bana::Platform::close_file(File *file) {
+    close(file->fd);
+
+    pthread_mutex_lock(&file_table_lock);
+    file_table.free((u8 *) file);
+    pthread_mutex_unlock(&file_table_lock);
+}
+
+Bana::Optional<Bana::FixedArray<u8>> Bana::Platform::read_entire_file_sync(const Bana::String path, Bana::Allocator allocator) {
+    // The result may be going to scratch memory itself, so keep the path off that arena.
+    Bana::ScratchMemory scratch(allocator);
+    char *cpath = linux_to_cstr(path, scratch.allocator());
+    i32 fd = open(cpath, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return {};
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return {};
+    }
+
+    usize file_size = st.st_size;
+    Bana::FixedArray<u8> ret = Bana::make_fixed_array<u8>(file_size, allocator);
+
+    if (file_size >= LINUX_MMAP_READ_THRESHOLD) {
+        // The caller owns the returned memory through its allocator, so we still have to copy. Faulting the pages in
+        // through a sequential mapping lets the kernel read ahead aggressively and skips the extra read() bookkeeping.
+        void *mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            free_fixed_array(&ret, allocator);
+            close(fd);
+            return {};
+        }
+
+        madvise(mapping, file_size, MADV_SEQUENTIAL);
+        std::memcpy(ret.data, mapping, file_size);
+        munmap(mapping, file_size);
+    } else if (!linux_read_all(fd, ret.data, file_size)) {
+        free_fixed_array(&ret, allocator);
+        close(fd);
+        return {};
+    }
+
+    ret.size = file_size;
+
+    close(fd);
+    return ret;
+}
+
+Bana::Optional<Bana::Platform::MappedFile> Bana::Platform::map_file(const Bana::String path, ReadAheadHint hint) {
+    Bana::ScratchMemory scratch;
+    char *cpath = linux_to_cstr(path, scratch.allocator());
+    i32 fd = open(cpath, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return {};
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return {};
+    }
+
+    MappedFile ret = {};
+    ret.size       = st.st_size;
+
+    // mmap() refuses zero length mappings. An empty view is still a valid file.
+    if (ret.size == 0) {
+        close(fd);
+        return ret;
+    }
+
+    void *mapping = mmap(nullptr, ret.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping holds its own reference to the file.
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        return {};
+    }
+
+    i32 advice = MADV_NORMAL;
+    switch (hint) {
+        case READ_AHEAD_NORMAL:     advice = MADV_NORMAL;     break;
+        case READ_AHEAD_SEQUENTIAL: advice = MADV_SEQUENTIAL; break;
+        case READ_AHEAD_RANDOM:     advice = MADV_RANDOM;     break;
+        case READ_AHEAD_WILLNEED:   advice = MADV_WILLNEED;   break;
+    }
+
+    madvise(mapping, ret.size, advice);
+
+    ret.data = (u8 *) mapping;
+    return ret;
+}
+
+void Bana::Platform::unmap_file(MappedFile *file) {
+    if (file->data) munmap(file->data, file->size);
+    file->data = nullptr;
+    file->size = 0;
+}
+
+static void *linux_thread_entry(void *arg) {
+    Bana::Platform::Thread *thread = (Bana::Platform::Thread *) arg;
+    thread->proc(thread->userdata);
+    Bana::free_scratch_arenas();
+    return nullptr;
+}
+
+Bana::Platform::Thread *Bana::Platform::create_thread(ThreadProc *proc, void *userdata) {
+    Thread *thread   = (Thread *) Bana::heap_allocator.alloc(sizeof(Thread));
+    thread->proc     = proc;
+    thread->userdata = userdata;
+
+    if (pthread_create(&thread->handle, nullptr, linux_thread_entry, thread) != 0) {
+        ICHIGO_ERROR("Failed to create thread!");
+        Bana::heap_allocator.free(thread);
+        return nullptr;
+    }
+
+    return thread;
+}
+
+void Bana::Platform::join_thread(Thread *thread) {
+    pthread_join(thread->handle, nullptr);
+    Bana::heap_allocator.free(thread);
+}
+
+u32 Bana::Platform::processor_count() {
+    // Respect affinity masks (taskset, cgroup cpusets) rather than counting every CPU in the machine.
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) return MAX(CPU_COUNT(&set), 1);
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online > 0 ? (u32) online : 1;
+}
+
+void Bana::Platform::yield_thread() {
+    sched_yield();
+}
+
+void Bana::Platform::futex_wait(u32 *address, u32 expected) {
+    syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+void Bana::Platform::futex_wake_one(u32 *address) {
+    syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+void Bana::Platform::futex_wake_all(u32 *address) {
+    syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+Bana::Platform::Mutex *Bana::Platform::create_mutex() {
+    Mutex *mutex = (Mutex *) Bana::heap_allocator.alloc(sizeof(Mutex));
+    pthread_mutex_init(&mutex->handle, nullptr);
+    return mutex;
+}
+
+void Bana::Platform::destroy_mutex(Mutex *mutex) {
+    pthread_mutex_destroy(&mutex->handle);
+    Bana::heap_allocator.free(mutex);
+}
+
+void Bana::Platform::lock_mutex(Mutex *mutex) {
+    pthread_mutex_lock(&mutex->handle);
+}
+
+void Bana::Platform::unlock_mutex(Mutex *mutex) {
+    pthread_mutex_unlock(&mutex->handle);
+}
+
+Bana::Platform::Semaphore *Bana::Platform::create_semaphore(u32 initial_count) {
+    Semaphore *semaphore = (Semaphore *) Bana::heap_allocator.alloc(sizeof(Semaphore));
+    sem_init(&semaphore->handle, 0, initial_count);
+    return semaphore;
+}
+
+void Bana::Platform::destroy_semaphore(Semaphore *semaphore) {
+    sem_destroy(&semaphore->handle);
+    Bana::heap_allocator.free(semaphore);
+}
+
+void Bana::Platform::signal_semaphore(Semaphore *semaphore, u32 count) {
+    for (u32 i = 0; i < count; ++i) sem_post(&semaphore->handle);
+}
+
+void Bana::Platform::wait_semaphore(Semaphore *semaphore) {
+    while (sem_wait(&semaphore->handle) != 0 && errno == EINTR);
+}
+
+// io_uring is driven through the raw syscalls so that there is no dependency on liburing.
+enum LinuxAsyncOp : u8 {
+    LINUX_ASYNC_READ,
+    LINUX_ASYNC_WRITE,
+};
+
+struct LinuxAsyncRequest {
+    Bana::Platform::AsyncIoProc *callback;
+    void *userdata;
+    u8 *buffer;
+    usize size;
+    u64 offset;
+    i64 result;
+    i32 fd;
+    i32 buffer_index;
+    LinuxAsyncOp op;
+    LinuxAsyncRequest *next_free;
+};
+
+struct Bana::Platform::AsyncFile {
+    i32 fd;
+    bool direct;
+};
+
+struct Bana::Platform::AsyncIo {
+    bool uses_io_uring;
+    LinuxAsyncRequest *requests;
+    LinuxAsyncRequest *free_requests;
+    u32 request_count;
+    u32 in_flight;
+    Bana::Array<AsyncBuffer> registered;
+
+    // io_uring.
+    i32 ring_fd;
+    u8 *sq_ring;
+    usize sq_ring_size;
+    u8 *cq_ring;
+    usize cq_ring_size;
+    io_uring_sqe *sqes;
+    usize sqes_size;
+    u32 *sq_head;
+    u32 *sq_tail;
+    u32 *sq_array;
+    u32 sq_mask;
+    u32 sq_entries;
+    u32 sq_unsubmitted;
+    // Set when io_uring_enter() fails with an error that retrying will not fix. Nothing more is submitted, and requests
+    // still sitting in the ring never complete.
+    bool ring_failed;
+    u32 *cq_head;
+    u32 *cq_tail;
+    u32 cq_mask;
+    io_uring_cqe *cqes;
+
+    // Thread pool fallback. Requests are staged until submit_async_io() so that batches go out together.
+    Bana::Array<LinuxAsyncRequest *> staged;
+    MpmcQueue<LinuxAsyncRequest *> pool_pending;
+    MpmcQueue<LinuxAsyncRequest *> pool_done;
+    Thread *pool_threads[ASYNC_IO_POOL_THREADS];
+};
+
+static i32 linux_io_uring_setup(u32 entries, io_uring_params *params) {
+    return (i32) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static i32 linux_io_uring_enter(i32 ring_fd, u32 to_submit, u32 min_complete, u32 flags) {
+    return (i32) syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static i32 linux_io_uring_register(i32 ring_fd, u32 opcode, void *arg, u32 nr_args) {
+    return (i32) syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+static bool linux_io_uring_init(Bana::Platform::AsyncIo *io, u32 queue_depth) {
+    io_uring_params params = {};
+    io->ring_fd            = linux_io_uring_setup(queue_depth, &params);
+    if (io->ring_fd < 0) return false;
+
+    // IORING_OP_READ/WRITE arrived in the same release as this feature bit.
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+        close(io->ring_fd);
+        return false;
+    }
+
+    io->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+    io->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    io->sqes_size    = params.sq_entries * sizeof(io_uring_sqe);
+
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) io->sq_ring_size = io->cq_ring_size = MAX(io->sq_ring_size, io->cq_ring_size);
+
+    void *sq_ring = mmap(nullptr, io->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, io->ring_fd, IORING_OFF_SQ_RING);
+    void *cq_ring = single_mmap ? sq_ring : mmap(nullptr, io->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, io->ring_fd, IORING_OFF_CQ_RING);
+    void *sqes    = mmap(nullptr, io->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, io->ring_fd, IORING_OFF_SQES);
+
+    if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes == MAP_FAILED) {
+        if (sq_ring != MAP_FAILED) munmap(sq_ring, io->sq_ring_size);
+        if (cq_ring != MAP_FAILED && !single_mmap) munmap(cq_ring, io->cq_ring_size);
+        if (sqes != MAP_FAILED) munmap(sqes, io->sqes_size);
+        close(io->ring_fd);
+        return false;
+    }
+
+    io->sq_ring    = (u8 *) sq_ring;
+    io->cq_ring    = (u8 *) cq_ring;
+    io->sqes       = (io_uring_sqe *) sqes;
+    io->sq_head    = (u32 *) (io->sq_ring + params.sq_off.head);
+    io->sq_tail    = (u32 *) (io->sq_ring + params.sq_off.tail);
+    io->sq_array   = (u32 *) (io->sq_ring + params.sq_off.array);
+    io->sq_mask    = *(u32 *) (io->sq_ring + params.sq_off.ring_mask);
+    io->sq_entries = params.sq_entries;
+    io->cq_head    = (u32 *) (io->cq_ring + params.cq_off.head);
+    io->cq_tail    = (u32 *) (io->cq_ring + params.cq_off.tail);
+    io->cq_mask    = *(u32 *) (io->cq_ring + params.cq_off.ring_mask);
+    io->cqes       = (io_uring_cqe *) (io->cq_ring + params.cq_off.cqes);
+
+    // Never have more in flight than the completion ring holds, so completions are never dropped or backlogged.
+    io->request_count = params.cq_entries;
+    return true;
+}
+
+static void linux_io_uring_deinit(Bana::Platform::AsyncIo *io) {
+    munmap(io->sqes, io->sqes_size);
+    if (io->cq_ring != io->sq_ring) munmap(io->cq_ring, io->cq_ring_size);
+    munmap(io->sq_ring, io->sq_ring_size);
+    close(io->ring_fd);
+}
+
+static void linux_async_pool_worker(void *userdata) {
+    Bana::Platform::AsyncIo *io = (Bana::Platform::AsyncIo *) userdata;
+
+    for (;;) {
+        LinuxAsyncRequest *request = io->pool_pending.pop();
+        if (!request) return;
+
+        isize result;
+        do {
+            result = request->op == LINUX_ASYNC_READ ? pread(request->fd, request->buffer, request->size, request->offset)
+                                                     : pwrite(request->fd, request->buffer, request->size, request->offset);
+        } while (result < 0 && errno == EINTR);
+
+        request->result = result < 0 ? -errno : result;
+        io->pool_done.push(request);
+    }
+}
+
+Bana::Platform::AsyncIo *Bana::Platform::create_async_io(u32 queue_depth, u32 flags) {
+    assert(queue_depth > 0);
+
+    // The pool's queues want their cursors on their own cache lines.
+    AsyncIo *io = (AsyncIo *) std::aligned_alloc(alignof(AsyncIo), (sizeof(AsyncIo) + alignof(AsyncIo) - 1) & ~(alignof(AsyncIo) - 1));
+    std::memset((void *) io, 0, sizeof(AsyncIo));
+
+    io->registered = make_array<AsyncBuffer>(8);
+    io->uses_io_uring = !FLAG_IS_SET(flags, ASYNC_IO_FORCE_THREAD_POOL) && linux_io_uring_init(io, queue_depth);
+
+    if (!io->uses_io_uring) {
+        io->request_count = queue_depth * 2;
+        io->staged        = make_array<LinuxAsyncRequest *>(queue_depth);
+        io->pool_pending  = make_mpmc_queue<LinuxAsyncRequest *>(io->request_count + ASYNC_IO_POOL_THREADS, true);
+        io->pool_done     = make_mpmc_queue<LinuxAsyncRequest *>(io->request_count, true);
+
+        for (u32 i = 0; i < ASYNC_IO_POOL_THREADS; ++i) io->pool_threads[i] = create_thread(linux_async_pool_worker, io);
+    }
+
+    io->requests = (LinuxAsyncRequest *) Bana::heap_allocator.alloc(io->request_count * sizeof(LinuxAsyncRequest));
+    for (u32 i = 0; i < io->request_count; ++i) {
+        io->requests[i].next_free = i + 1 < io->request_count ? &io->requests[i + 1] : nullptr;
+    }
+
+    io->free_requests = io->requests;
+    return io;
+}
+
+void Bana::Platform::destroy_async_io(AsyncIo *io) {
+    while (io->in_flight > 0 && !io->ring_failed) poll_async_io(io, io->in_flight);
+
+    if (io->uses_io_uring) {
+        linux_io_uring_deinit(io);
+    } else {
+        for (u32 i = 0; i < ASYNC_IO_POOL_THREADS; ++i) io->pool_pending.push(nullptr);
+        for (u32 i = 0; i < ASYNC_IO_POOL_THREADS; ++i) {
+            if (io->pool_threads[i]) join_thread(io->pool_threads[i]);
+        }
+
+        free_mpmc_queue(&io->pool_pending);
+        free_mpmc_queue(&io->pool_done);
+        free_array(&io->staged);
+    }
+
+    free_array(&io->registered);
+    Bana::heap_allocator.free(io->requests);
+    std::free(io);
+}
+
+bool Bana::Platform::async_io_uses_io_uring(const AsyncIo *io) {
+    return io->uses_io_uring;
+}
+
+u32 Bana::Platform::async_io_in_flight(const AsyncIo *io) {
+    return io->in_flight;
+}
+
+Bana::Platform::AsyncFile *Bana::Platform::open_async_file([[maybe_unused]] AsyncIo *io, const Bana::String path, u32 flags) {
+    i32 oflags = O_CLOEXEC;
+    if (FLAG_IS_SET(flags, ASYNC_FILE_READ) && FLAG_IS_SET(flags, ASYNC_FILE_WRITE)) oflags |= O_RDWR;
+    else if (FLAG_IS_SET(flags, ASYNC_FILE_WRITE))                                   oflags |= O_WRONLY;
+    else                                                                              oflags |= O_RDONLY;
+
+    if (FLAG_IS_SET(flags, ASYNC_FILE_CREATE)) oflags |= O_CREAT | O_TRUNC;
+    if (FLAG_IS_SET(flags, ASYNC_FILE_DIRECT)) oflags |= O_DIRECT;
+
+    Bana::ScratchMemory scratch;
+    char *cpath = linux_to_cstr(path, scratch.allocator());
+    i32 fd      = open(cpath, oflags, 0644);
+
+    if (fd < 0) {
+        ICHIGO_ERROR("Failed to open file for async I/O!");
+        return nullptr;
+    }
+
+    AsyncFile *file = (AsyncFile *) Bana::heap_allocator.alloc(sizeof(AsyncFile));
+    file->fd        = fd;
+    file->direct    = FLAG_IS_SET(flags, ASYNC_FILE_DIRECT);
+    return file;
+}
+
+void Bana::Platform::close_async_file(AsyncFile *file) {
+    close(file->fd);
+    Bana::heap_allocator.free(file);
+}
+
+Bana::Optional<u64> Bana::Platform::async_file_size(AsyncFile *file) {
+    struct stat st;
+    if (fstat(file->fd, &st) != 0) return {};
+    return (u64) st.st_size;
+}
+
+bool Bana::Platform::register_async_buffers(AsyncIo *io, const AsyncBuffer *buffers, u32 count) {
+    assert(io->in_flight == 0);
+
+    if (io->uses_io_uring) {
+        if (io->registered.size > 0) linux_io_uring_register(io->ring_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+        io->registered.size = 0;
+
+        if (count > 0) {
+            Bana::ScratchMemory scratch;
+            iovec *iovecs = (iovec *) scratch.allocator().alloc(count * sizeof(iovec));
+            for (u32 i = 0; i < count; ++i) iovecs[i] = { buffers[i].data, buffers[i].size };
+
+            if (linux_io_uring_register(io->ring_fd, IORING_REGISTER_BUFFERS, iovecs, count) < 0) {
+                ICHIGO_ERROR("Failed to register async I/O buffers!");
+                return false;
+            }
+        }
+    }
+
+    io->registered.size = 0;
+    for (u32 i = 0; i < count; ++i) io->registered.append(buffers[i]);
+    return true;
+}
+
+static i32 linux_find_registered_buffer(Bana::Platform::AsyncIo *io, const u8 *buffer, usize size) {
+    for (isize i = 0; i < io->registered.size; ++i) {
+        const u8 *start = (const u8 *) io->registered[i].data;
+        if (buffer >= start && buffer + size <= start + io->registered[i].size) return (i32) i;
+    }
+
+    return -1;
+}
+
+static bool linux_submit_async(Bana::Platform::AsyncIo *io, Bana::Platform::AsyncFile *file, LinuxAsyncOp op, u8 *buffer, usize size, u64 offset, Bana::Platform::AsyncIoProc *callback, void *userdata) {
+    // The kernel caps a single read or write at just under 2GB anyway.
+    assert(size <= 0x7FFFF000);
+    assert(!file->direct || ((uptr) buffer % ASYNC_IO_DIRECT_ALIGNMENT == 0 && size % ASYNC_IO_DIRECT_ALIGNMENT == 0 && offset % ASYNC_IO_DIRECT_ALIGNMENT == 0));
+
+    LinuxAsyncRequest *request = io->free_requests;
+    if (!request) return false;
+
+    u32 tail = 0;
+    if (io->uses_io_uring) {
+        if (io->ring_failed) return false;
+
+        tail = *io->sq_tail;
+        if (tail - Bana::Platform::atomic_load(io->sq_head, Bana::Platform::MEMORY_ORDER_ACQUIRE) == io->sq_entries) {
+            Bana::Platform::submit_async_io(io);
+            tail = *io->sq_tail;
+
+            // Submitting failed and left the ring full. Writing the entry now would overwrite one that is still queued.
+            if (tail - Bana::Platform::atomic_load(io->sq_head, Bana::Platform::MEMORY_ORDER_ACQUIRE) == io->sq_entries) return false;
+        }
+    }
+
+    io->free_requests     = request->next_free;
+    request->callback     = callback;
+    request->userdata     = userdata;
+    request->buffer       = buffer;
+    request->size         = size;
+    request->offset       = offset;
+    request->result       = 0;
+    request->fd           = file->fd;
+    request->op           = op;
+    request->buffer_index = io->uses_io_uring ? linux_find_registered_buffer(io, buffer, size) : -1;
+    io->in_flight++;
+
+    if (!io->uses_io_uring) {
+        io->staged.append(request);
+        return true;
+    }
+
+    io_uring_sqe *sqe = &io->sqes[tail & io->sq_mask];
+    std::memset(sqe, 0, sizeof(io_uring_sqe));
+
+    bool fixed = request->buffer_index >= 0;
+    if (op == LINUX_ASYNC_READ) sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    else                        sqe->opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+
+    sqe->fd        = file->fd;
+    sqe->addr      = (u64) (uptr) buffer;
+    sqe->len       = (u32) size;
+    sqe->off       = offset;
+    sqe->buf_index = fixed ? (u16) request->buffer_index : 0;
+    sqe->user_data = (u64) (uptr) request;
+
+    io->sq_array[tail & io->sq_mask] = tail & io->sq_mask;
+    Bana::Platform::atomic_store(io->sq_tail, tail + 1, Bana::Platform::MEMORY_ORDER_RELEASE);
+    io->sq_unsubmitted++;
+
+    return true;
+}
+
+bool Bana::Platform::submit_read(AsyncIo *io, AsyncFile *file, void *buffer, usize size, u64 offset, AsyncIoProc *callback, void *userdata) {
+    return linux_submit_async(io, file, LINUX_ASYNC_READ, (u8 *) buffer, size, offset, callback, userdata);
+}
+
+bool Bana::Platform::submit_write(AsyncIo *io, AsyncFile *file, const void *buffer, usize size, u64 offset, AsyncIoProc *callback, void *userdata) {
+    return linux_submit_async(io, file, LINUX_ASYNC_WRITE, (u8 *) buffer, size, offset, callback, userdata);
+}
+
+// Enter the ring, submitting everything queued and optionally waiting for completions. Returns false if the ring has
+// failed for good.
+static bool linux_io_uring_enter_all(Bana::Platform::AsyncIo *io, u32 min_complete) {
+    if (io->ring_failed) return false;
+
+    for (;;) {
+        u32 flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+        i32 ret   = linux_io_uring_enter(io->ring_fd, io->sq_unsubmitted, min_complete, flags);
+
+        if (ret >= 0) {
+            io->sq_unsubmitted -= MIN((u32) ret, io->sq_unsubmitted);
+            if (io->sq_unsubmitted == 0 || min_complete > 0) return true;
+            continue;
+        }
+
+        if (errno == EINTR) continue;
+
+        // Out of kernel resources for now. Completions free them up, and we never have more in flight than fit.
+        if (errno == EAGAIN || errno == EBUSY) {
+            if (min_complete == 0) min_complete = 1;
+            continue;
+        }
+
+        ICHIGO_ERROR("io_uring_enter failed: %d, %u requests in flight will not complete", errno, io->in_flight);
+        io->ring_failed = true;
+        return false;
+    }
+}
+
+u32 Bana::Platform::submit_async_io(AsyncIo *io) {
+    if (io->uses_io_uring) {
+        u32 queued = io->sq_unsubmitted;
+        if (queued > 0) linux_io_uring_enter_all(io, 0);
+        return queued - io->sq_unsubmitted;
+    }
+
+    u32 queued = io->staged.size;
+    io->pool_pending.push_batch(io->staged.data, io->staged.size);
+    io->staged.size = 0;
+    return queued;
+}
+
+static void linux_complete_async(Bana::Platform::AsyncIo *io, LinuxAsyncRequest *request, i64 result) {
+    Bana::Platform::AsyncCompletion completion = { request->userdata, request->buffer, request->size, request->offset, result };
+    Bana::Platform::AsyncIoProc *callback      = request->callback;
+
+    // Release the slot first so that the callback can queue follow up requests.
+    request->next_free = io->free_requests;
+    io->free_requests  = request;
+    io->in_flight--;
+
+    if (callback) callback(&completion);
+}
+
+static u32 linux_reap_io_uring(Bana::Platform::AsyncIo *io) {
+    u32 head    = *io->cq_head;
+    u32 tail    = Bana::Platform::atomic_load(io->cq_tail, Bana::Platform::MEMORY_ORDER_ACQUIRE);
+    u32 reaped  = 0;
+
+    for (; head != tail; ++head, ++reaped) {
+        io_uring_cqe *cqe          = &io->cqes[head & io->cq_mask];
+        LinuxAsyncRequest *request = (LinuxAsyncRequest *) (uptr) cqe->user_data;
+        i64 result                 = cqe->res;
+
+        Bana::Platform::atomic_store(io->cq_head, head + 1, Bana::Platform::MEMORY_ORDER_RELEASE);
+        linux_complete_async(io, request, result);
+    }
+
+    return reaped;
+}
+
+u32 Bana::Platform::poll_async_io(AsyncIo *io, u32 min_completions) {
+    u32 handled = 0;
+
+    if (io->uses_io_uring) {
+        if (io->sq_unsubmitted > 0) linux_io_uring_enter_all(io, 0);
+        handled += linux_reap_io_uring(io);
+
+        while (handled < min_completions && io->in_flight > 0) {
+            if (!linux_io_uring_enter_all(io, MIN(min_completions - handled, io->in_flight))) break;
+            handled += linux_reap_io_uring(io);
+        }
+
+        return handled;
+    }
+
+    submit_async_io(io);
+
+    LinuxAsyncRequest *done[64];
+    for (;;) {
+        isize n = io->pool_done.try_pop_batch(done, ARRAY_LEN(done));
+        if (n == 0) {
+            if (handled >= min_completions || io->in_flight == 0) return handled;
+            n = io->pool_done.pop_batch(done, ARRAY_LEN(done));
+        }
+
+        for (isize i = 0; i < n; ++i) linux_complete_async(io, done[i], done[i]->result);
+        handled += n;
+    }
+}
+
+bool Bana::Platform::file_exists(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 && !S_ISDIR(st.st_mode);
+}
+
+void Bana::Platform::sleep(f64 t) {
+    if (t <= 0.0) return;
+
+    // clock_nanosleep() does not accept CLOCK_MONOTONIC_RAW, but an absolute deadline on CLOCK_MONOTONIC is immune to
+    // signal interruptions drifting the total sleep time.
+    timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    i64 ns = (i64) (t * 1000000000.0);
+    deadline.tv_sec  += ns / 1000000000;
+    deadline.tv_nsec += ns % 1000000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec  += 1;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR);
+}
+
+f64 Bana::Platform::get_current_time() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (f64) ts.tv_sec + (f64) ts.tv_nsec / 1000000000.0;
+}
+
+void Bana::Platform::init() {
+    file_table = Bana::make_free_list(sizeof(File), LINUX_FILE_TABLE_SLAB);
+}
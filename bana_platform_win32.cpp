@@ -11,7 +11,28 @@ struct Bana::Platform::File {
     HANDLE file_handle;
 };
 
-static Bana::Platform::File open_files[32];
+// Open files live in a free list that grows a slab at a time, so there is no limit on how many can be open and a File
+// pointer stays valid until it is closed.
+#define WIN32_FILE_TABLE_SLAB 64
+// WriteFile takes a DWORD size, so big writes go out in pieces.
+#define WIN32_MAX_WRITE       GIGABYTES(1)
+
+static Bana::FreeList file_table;
+static SRWLOCK file_table_lock = SRWLOCK_INIT;
+
+struct Bana::Platform::Thread {
+    HANDLE handle;
+    ThreadProc *proc;
+    void *userdata;
+};
+
+struct Bana::Platform::Mutex {
+    SRWLOCK lock;
+};
+
+struct Bana::Platform::Semaphore {
+    HANDLE handle;
+};
 
 static i64 win32_get_timestamp() {
     LARGE_INTEGER i;
@@ -44,38 +65,46 @@ wchar_t *Bana::Platform::win32_to_wide_char(const Bana::String &str, Bana::Alloc
 }
 
 Bana::Platform::File *Bana::Platform::open_file_write(Bana::String path) {
-    wchar_t *pathw = win32_to_wide_char(path);
+    Bana::ScratchMemory scratch;
+    wchar_t *pathw = win32_to_wide_char(path, scratch.allocator());
     HANDLE file = CreateFile(pathw, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
-    std::free(pathw);
 
     if (file == INVALID_HANDLE_VALUE) {
         ICHIGO_ERROR("Failed to open file for writing!");
         return nullptr;
     }
 
-    for (u32 i = 0; i < ARRAY_LEN(open_files); ++i) {
-        if (open_files[i].file_handle == INVALID_HANDLE_VALUE) {
-            open_files[i].file_handle = file;
-            return &open_files[i];
-        }
+    AcquireSRWLockExclusive(&file_table_lock);
+    File *ret = (File *) file_table.alloc(sizeof(File));
+    ReleaseSRWLockExclusive(&file_table_lock);
+
+    ret->file_handle = file;
+    return ret;
+}
+
+static bool win32_write_all(HANDLE file, const u8 *data, usize data_size) {
+    while (data_size > 0) {
+        DWORD bytes_written = 0;
+        if (!WriteFile(file, data, (DWORD) MIN(data_size, (usize) WIN32_MAX_WRITE), &bytes_written, nullptr)) return false;
+
+        data      += bytes_written;
+        data_size -= bytes_written;
     }
 
-    ICHIGO_ERROR("Too many files open!");
-    return nullptr;
+    return true;
 }
 
 void Bana::Platform::write_entire_file_sync(const char *path, const u8 *data, usize data_size) {
-    wchar_t *pathw = win32_to_wide_char(Bana::temp_string(path));
+    Bana::ScratchMemory scratch;
+    wchar_t *pathw = win32_to_wide_char(Bana::temp_string(path), scratch.allocator());
     HANDLE file = CreateFile(pathw, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
-    std::free(pathw);
 
     if (file == INVALID_HANDLE_VALUE) {
         ICHIGO_ERROR("Failed to open file for writing!");
         return;
     }
 
-    DWORD bytes_written = 0;
-    if (!WriteFile(file, data, data_size, &bytes_written, nullptr)) {
+    if (!win32_write_all(file, data, data_size)) {
         ICHIGO_ERROR("Failed to write file!");
     }
 
@@ -83,21 +112,45 @@ void Bana::Platform::write_entire_file_sync(const char *path, const u8 *data, us
 }
 
 void Bana::Platform::append_file_sync(File *file, const u8 *data, usize data_size) {
-    DWORD bytes_written = 0;
-    if (!WriteFile(file->file_handle, data, data_size, &bytes_written, nullptr)) {
+    if (!win32_write_all(file->file_handle, data, data_size)) {
         ICHIGO_ERROR("Failed to write to file!");
     }
 }
 
+// WriteFileGather only works on unbuffered handles with page sized segments, so segments are written one at a time.
+bool Bana::Platform::write_file_gather(File *file, const Bana::String *segments, isize count) {
+    for (isize i = 0; i < count; ++i) {
+        if (!win32_write_all(file->file_handle, (const u8 *) segments[i].data, segments[i].length)) {
+            ICHIGO_ERROR("Failed to write to file!");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Bana::Platform::sync_file(File *file) {
+    if (!FlushFileBuffers(file->file_handle)) {
+        ICHIGO_ERROR("Failed to sync file!");
+        return false;
+    }
+
+    return true;
+}
+
 void Bana::Platform::close_file(File *file) {
     CloseHandle(file->file_handle);
-    file->file_handle = INVALID_HANDLE_VALUE;
+
+    AcquireSRWLockExclusive(&file_table_lock);
+    file_table.free((u8 *) file);
+    ReleaseSRWLockExclusive(&file_table_lock);
 }
 
 Bana::Optional<Bana::FixedArray<u8>> Bana::Platform::read_entire_file_sync(const Bana::String path, Bana::Allocator allocator) {
-    wchar_t *pathw = win32_to_wide_char(path);
+    // The result may be going to scratch memory itself, so keep the path off that arena.
+    Bana::ScratchMemory scratch(allocator);
+    wchar_t *pathw = win32_to_wide_char(path, scratch.allocator());
     HANDLE handle = CreateFile(pathw, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-    std::free(pathw);
 
     if (handle == INVALID_HANDLE_VALUE) {
         return {};
@@ -123,12 +176,357 @@ Bana::Optional<Bana::FixedArray<u8>> Bana::Platform::read_entire_file_sync(const
     return ret;
 }
 
+Bana::Optional<Bana::Platform::MappedFile> Bana::Platform::map_file(const Bana::String path, ReadAheadHint hint) {
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+    if      (hint == READ_AHEAD_SEQUENTIAL) flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+    else if (hint == READ_AHEAD_RANDOM)     flags |= FILE_FLAG_RANDOM_ACCESS;
+
+    Bana::ScratchMemory scratch;
+    wchar_t *pathw = win32_to_wide_char(path, scratch.allocator());
+    HANDLE handle = CreateFile(pathw, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+
+    if (handle == INVALID_HANDLE_VALUE) {
+        return {};
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(handle, &file_size)) {
+        CloseHandle(handle);
+        return {};
+    }
+
+    MappedFile ret = {};
+    ret.size       = file_size.QuadPart;
+
+    // CreateFileMapping() refuses zero length files. An empty view is still a valid file.
+    if (ret.size == 0) {
+        CloseHandle(handle);
+        return ret;
+    }
+
+    HANDLE mapping = CreateFileMapping(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(handle);
+
+    if (!mapping) {
+        return {};
+    }
+
+    // The view keeps the mapping object alive.
+    ret.data = (u8 *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+
+    if (!ret.data) {
+        return {};
+    }
+
+    if (hint == READ_AHEAD_WILLNEED) {
+        WIN32_MEMORY_RANGE_ENTRY range = { ret.data, ret.size };
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+
+    return ret;
+}
+
+void Bana::Platform::unmap_file(MappedFile *file) {
+    if (file->data) UnmapViewOfFile(file->data);
+    file->data = nullptr;
+    file->size = 0;
+}
+
+static DWORD WINAPI win32_thread_entry(LPVOID arg) {
+    Bana::Platform::Thread *thread = (Bana::Platform::Thread *) arg;
+    thread->proc(thread->userdata);
+    Bana::free_scratch_arenas();
+    return 0;
+}
+
+Bana::Platform::Thread *Bana::Platform::create_thread(ThreadProc *proc, void *userdata) {
+    Thread *thread   = (Thread *) Bana::heap_allocator.alloc(sizeof(Thread));
+    thread->proc     = proc;
+    thread->userdata = userdata;
+    thread->handle   = CreateThread(nullptr, 0, win32_thread_entry, thread, 0, nullptr);
+
+    if (!thread->handle) {
+        ICHIGO_ERROR("Failed to create thread!");
+        Bana::heap_allocator.free(thread);
+        return nullptr;
+    }
+
+    return thread;
+}
+
+void Bana::Platform::join_thread(Thread *thread) {
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    Bana::heap_allocator.free(thread);
+}
+
+u32 Bana::Platform::processor_count() {
+    DWORD count = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+    return count > 0 ? count : 1;
+}
+
+void Bana::Platform::yield_thread() {
+    SwitchToThread();
+}
+
+// WaitOnAddress lives in Synchronization.lib.
+void Bana::Platform::futex_wait(u32 *address, u32 expected) {
+    WaitOnAddress(address, &expected, sizeof(u32), INFINITE);
+}
+
+void Bana::Platform::futex_wake_one(u32 *address) {
+    WakeByAddressSingle(address);
+}
+
+void Bana::Platform::futex_wake_all(u32 *address) {
+    WakeByAddressAll(address);
+}
+
+Bana::Platform::Mutex *Bana::Platform::create_mutex() {
+    Mutex *mutex = (Mutex *) Bana::heap_allocator.alloc(sizeof(Mutex));
+    InitializeSRWLock(&mutex->lock);
+    return mutex;
+}
+
+void Bana::Platform::destroy_mutex(Mutex *mutex) {
+    Bana::heap_allocator.free(mutex);
+}
+
+void Bana::Platform::lock_mutex(Mutex *mutex) {
+    AcquireSRWLockExclusive(&mutex->lock);
+}
+
+void Bana::Platform::unlock_mutex(Mutex *mutex) {
+    ReleaseSRWLockExclusive(&mutex->lock);
+}
+
+Bana::Platform::Semaphore *Bana::Platform::create_semaphore(u32 initial_count) {
+    Semaphore *semaphore = (Semaphore *) Bana::heap_allocator.alloc(sizeof(Semaphore));
+    semaphore->handle    = CreateSemaphoreW(nullptr, initial_count, LONG_MAX, nullptr);
+    return semaphore;
+}
+
+void Bana::Platform::destroy_semaphore(Semaphore *semaphore) {
+    CloseHandle(semaphore->handle);
+    Bana::heap_allocator.free(semaphore);
+}
+
+void Bana::Platform::signal_semaphore(Semaphore *semaphore, u32 count) {
+    if (count > 0) ReleaseSemaphore(semaphore->handle, count, nullptr);
+}
+
+void Bana::Platform::wait_semaphore(Semaphore *semaphore) {
+    WaitForSingleObject(semaphore->handle, INFINITE);
+}
+
+// Requests that failed before reaching the kernel are posted to the port by hand under this key with their result set.
+#define WIN32_ASYNC_FAILED_KEY 1
+#define WIN32_STATUS_END_OF_FILE 0xC0000011
+
+struct Win32AsyncRequest {
+    OVERLAPPED overlapped;
+    Bana::Platform::AsyncIoProc *callback;
+    void *userdata;
+    u8 *buffer;
+    usize size;
+    u64 offset;
+    i64 result;
+    HANDLE file;
+    bool write;
+    Win32AsyncRequest *next_free;
+};
+
+struct Bana::Platform::AsyncFile {
+    HANDLE handle;
+    bool direct;
+};
+
+struct Bana::Platform::AsyncIo {
+    HANDLE port;
+    Win32AsyncRequest *requests;
+    Win32AsyncRequest *free_requests;
+    u32 request_count;
+    u32 in_flight;
+    Bana::Array<Win32AsyncRequest *> staged;
+};
+
+Bana::Platform::AsyncIo *Bana::Platform::create_async_io(u32 queue_depth, [[maybe_unused]] u32 flags) {
+    assert(queue_depth > 0);
+
+    AsyncIo *io       = (AsyncIo *) Bana::heap_allocator.alloc(sizeof(AsyncIo));
+    io->port          = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+    io->request_count = queue_depth * 2;
+    io->in_flight     = 0;
+    io->staged        = make_array<Win32AsyncRequest *>(queue_depth);
+    io->requests      = (Win32AsyncRequest *) Bana::heap_allocator.alloc(io->request_count * sizeof(Win32AsyncRequest));
+
+    for (u32 i = 0; i < io->request_count; ++i) {
+        io->requests[i].next_free = i + 1 < io->request_count ? &io->requests[i + 1] : nullptr;
+    }
+
+    io->free_requests = io->requests;
+    return io;
+}
+
+void Bana::Platform::destroy_async_io(AsyncIo *io) {
+    while (io->in_flight > 0) poll_async_io(io, io->in_flight);
+
+    CloseHandle(io->port);
+    free_array(&io->staged);
+    Bana::heap_allocator.free(io->requests);
+    Bana::heap_allocator.free(io);
+}
+
+bool Bana::Platform::async_io_uses_io_uring([[maybe_unused]] const AsyncIo *io) {
+    return false;
+}
+
+u32 Bana::Platform::async_io_in_flight(const AsyncIo *io) {
+    return io->in_flight;
+}
+
+Bana::Platform::AsyncFile *Bana::Platform::open_async_file(AsyncIo *io, const Bana::String path, u32 flags) {
+    DWORD access = 0;
+    if (FLAG_IS_SET(flags, ASYNC_FILE_READ))  access |= GENERIC_READ;
+    if (FLAG_IS_SET(flags, ASYNC_FILE_WRITE)) access |= GENERIC_WRITE;
+    if (access == 0)                          access  = GENERIC_READ;
+
+    DWORD disposition = FLAG_IS_SET(flags, ASYNC_FILE_CREATE) ? CREATE_ALWAYS : OPEN_EXISTING;
+    DWORD attributes  = FILE_FLAG_OVERLAPPED;
+    if (FLAG_IS_SET(flags, ASYNC_FILE_DIRECT)) attributes |= FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH;
+
+    Bana::ScratchMemory scratch;
+    wchar_t *wide_path = win32_to_wide_char(path, scratch.allocator());
+    HANDLE handle      = CreateFileW(wide_path, access, FILE_SHARE_READ, nullptr, disposition, attributes, nullptr);
+
+    if (handle == INVALID_HANDLE_VALUE) {
+        ICHIGO_ERROR("Failed to open file for async I/O!");
+        return nullptr;
+    }
+
+    CreateIoCompletionPort(handle, io->port, 0, 0);
+
+    AsyncFile *file = (AsyncFile *) Bana::heap_allocator.alloc(sizeof(AsyncFile));
+    file->handle    = handle;
+    file->direct    = FLAG_IS_SET(flags, ASYNC_FILE_DIRECT);
+    return file;
+}
+
+void Bana::Platform::close_async_file(AsyncFile *file) {
+    CloseHandle(file->handle);
+    Bana::heap_allocator.free(file);
+}
+
+Bana::Optional<u64> Bana::Platform::async_file_size(AsyncFile *file) {
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file->handle, &size)) return {};
+    return (u64) size.QuadPart;
+}
+
+// Overlapped I/O has no equivalent of registered buffers short of registered I/O, which only covers sockets.
+bool Bana::Platform::register_async_buffers([[maybe_unused]] AsyncIo *io, [[maybe_unused]] const AsyncBuffer *buffers, [[maybe_unused]] u32 count) {
+    assert(io->in_flight == 0);
+    return true;
+}
+
+static bool win32_submit_async(Bana::Platform::AsyncIo *io, Bana::Platform::AsyncFile *file, bool write, u8 *buffer, usize size, u64 offset, Bana::Platform::AsyncIoProc *callback, void *userdata) {
+    assert(size <= 0xFFFFFFFF);
+    assert(!file->direct || ((uptr) buffer % ASYNC_IO_DIRECT_ALIGNMENT == 0 && size % ASYNC_IO_DIRECT_ALIGNMENT == 0 && offset % ASYNC_IO_DIRECT_ALIGNMENT == 0));
+
+    Win32AsyncRequest *request = io->free_requests;
+    if (!request) return false;
+
+    io->free_requests = request->next_free;
+    request->callback = callback;
+    request->userdata = userdata;
+    request->buffer   = buffer;
+    request->size     = size;
+    request->offset   = offset;
+    request->result   = 0;
+    request->file     = file->handle;
+    request->write    = write;
+    io->in_flight++;
+
+    io->staged.append(request);
+    return true;
+}
+
+bool Bana::Platform::submit_read(AsyncIo *io, AsyncFile *file, void *buffer, usize size, u64 offset, AsyncIoProc *callback, void *userdata) {
+    return win32_submit_async(io, file, false, (u8 *) buffer, size, offset, callback, userdata);
+}
+
+bool Bana::Platform::submit_write(AsyncIo *io, AsyncFile *file, const void *buffer, usize size, u64 offset, AsyncIoProc *callback, void *userdata) {
+    return win32_submit_async(io, file, true, (u8 *) buffer, size, offset, callback, userdata);
+}
+
+u32 Bana::Platform::submit_async_io(AsyncIo *io) {
+    for (isize i = 0; i < io->staged.size; ++i) {
+        Win32AsyncRequest *request = io->staged[i];
+        std::memset(&request->overlapped, 0, sizeof(OVERLAPPED));
+        request->overlapped.Offset     = (DWORD) request->offset;
+        request->overlapped.OffsetHigh = (DWORD) (request->offset >> 32);
+
+        BOOL ok = request->write ? WriteFile(request->file, request->buffer, (DWORD) request->size, nullptr, &request->overlapped)
+                                 : ReadFile(request->file, request->buffer, (DWORD) request->size, nullptr, &request->overlapped);
+
+        if (!ok) {
+            DWORD error = GetLastError();
+            if (error != ERROR_IO_PENDING) {
+                request->result = error == ERROR_HANDLE_EOF ? 0 : -(i64) error;
+                PostQueuedCompletionStatus(io->port, 0, WIN32_ASYNC_FAILED_KEY, &request->overlapped);
+            }
+        }
+    }
+
+    u32 submitted    = io->staged.size;
+    io->staged.size  = 0;
+    return submitted;
+}
+
+u32 Bana::Platform::poll_async_io(AsyncIo *io, u32 min_completions) {
+    submit_async_io(io);
+
+    u32 handled = 0;
+    while (io->in_flight > 0) {
+        OVERLAPPED_ENTRY entries[64];
+        ULONG removed = 0;
+        DWORD timeout = handled < min_completions ? INFINITE : 0;
+
+        if (!GetQueuedCompletionStatusEx(io->port, entries, ARRAY_LEN(entries), &removed, timeout, FALSE)) break;
+
+        for (ULONG i = 0; i < removed; ++i) {
+            Win32AsyncRequest *request = CONTAINING_RECORD(entries[i].lpOverlapped, Win32AsyncRequest, overlapped);
+            i64 result                 = request->result;
+
+            if (entries[i].lpCompletionKey != WIN32_ASYNC_FAILED_KEY) {
+                DWORD status = (DWORD) request->overlapped.Internal;
+                if (status == 0)                             result = entries[i].dwNumberOfBytesTransferred;
+                else if (status == WIN32_STATUS_END_OF_FILE) result = 0;
+                else                                         result = -(i64) status;
+            }
+
+            AsyncCompletion completion = { request->userdata, request->buffer, request->size, request->offset, result };
+            AsyncIoProc *callback      = request->callback;
+
+            request->next_free = io->free_requests;
+            io->free_requests  = request;
+            io->in_flight--;
+
+            if (callback) callback(&completion);
+        }
+
+        handled += removed;
+    }
+
+    return handled;
+}
+
 bool Bana::Platform::file_exists(const char *path) {
-    wchar_t *wide_path = win32_to_wide_char(Bana::temp_string(path));
+    Bana::ScratchMemory scratch;
+    wchar_t *wide_path = win32_to_wide_char(Bana::temp_string(path), scratch.allocator());
     DWORD attributes = GetFileAttributesW(wide_path);
-    bool ret = attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
-    std::free(wide_path);
-    return ret;
+    return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
 }
 
 void Bana::Platform::sleep(f64 t) {
@@ -144,9 +542,7 @@ void Bana::Platform::init() {
     QueryPerformanceFrequency(&frequency);
     performance_frequency = frequency.QuadPart;
 
-    for (u32 i = 0; i < ARRAY_LEN(open_files); ++i) {
-        open_files[i].file_handle = INVALID_HANDLE_VALUE;
-    }
+    file_table = Bana::make_free_list(sizeof(File), WIN32_FILE_TABLE_SLAB);
 
     assert(timeBeginPeriod(1) == TIMERR_NOERROR);
 }